@@ -0,0 +1,488 @@
+#include "AccessorReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ACCESSOR_READER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Scale and lower bound turning a component into its float value.
+struct Conversion
+{
+	float scale = 1.0f;
+	float lower = std::numeric_limits<float>::lowest();
+};
+
+Conversion conversion(const int componentType, const bool normalized)
+{
+	if (!normalized)
+	{
+		return {};
+	}
+
+	// Signed normalized values clamp at -1, the most negative integer would map below it.
+	switch (componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			return {1.0f / 127.0f, -1.0f};
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return {1.0f / 255.0f};
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			return {1.0f / 32767.0f, -1.0f};
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			return {1.0f / 65535.0f};
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+			return {1.0f / 4294967295.0f};
+		default:
+			return {};
+	}
+}
+
+template<typename T>
+float load(const unsigned char * const p)
+{
+	T value;
+	std::memcpy(&value, p, sizeof(T));
+	return static_cast<float>(value);
+}
+
+float component(const unsigned char * const p, const int componentType, const Conversion & c)
+{
+	float value = 0;
+	switch (componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			value = load<int8_t>(p);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			value = load<uint8_t>(p);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			value = load<int16_t>(p);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			value = load<uint16_t>(p);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+			value = load<uint32_t>(p);
+			break;
+		case TINYGLTF_COMPONENT_TYPE_FLOAT:
+			return load<float>(p);
+		default:
+			return 0;
+	}
+	return std::max(value * c.scale, c.lower);
+}
+
+#ifdef ACCESSOR_READER_SSE2
+inline void store(float * const dst, const __m128i ints, const __m128 scale, const __m128 lower)
+{
+	_mm_storeu_ps(dst, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(ints), scale), lower));
+}
+#endif
+
+// Converts n contiguous components, 16 bytes of source per SIMD step.
+void convert(const unsigned char * const src, const size_t n, const int componentType, const Conversion & c,
+			 float * const dst)
+{
+	size_t i = 0;
+	if (componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+	{
+		std::memcpy(dst, src, n * sizeof(float));
+		return;
+	}
+
+#ifdef ACCESSOR_READER_SSE2
+	const __m128 scale = _mm_set1_ps(c.scale);
+	const __m128 lower = _mm_set1_ps(c.lower);
+	const __m128i zero = _mm_setzero_si128();
+	const auto * const v = reinterpret_cast<const __m128i *>(src);
+
+	switch (componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			for (; i + 16 <= n; i += 16)
+			{
+				const __m128i bytes = _mm_loadu_si128(v + i / 16);
+				const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+				const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+				store(dst + i, _mm_unpacklo_epi16(lo, zero), scale, lower);
+				store(dst + i + 4, _mm_unpackhi_epi16(lo, zero), scale, lower);
+				store(dst + i + 8, _mm_unpacklo_epi16(hi, zero), scale, lower);
+				store(dst + i + 12, _mm_unpackhi_epi16(hi, zero), scale, lower);
+			}
+			break;
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			for (; i + 16 <= n; i += 16)
+			{
+				// Sign extension: duplicate into the high half, then shift arithmetically.
+				const __m128i bytes = _mm_loadu_si128(v + i / 16);
+				const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+				const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8);
+				store(dst + i, _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), scale, lower);
+				store(dst + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), scale, lower);
+				store(dst + i + 8, _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), scale, lower);
+				store(dst + i + 12, _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), scale, lower);
+			}
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			for (; i + 8 <= n; i += 8)
+			{
+				const __m128i shorts = _mm_loadu_si128(v + i / 8);
+				store(dst + i, _mm_unpacklo_epi16(shorts, zero), scale, lower);
+				store(dst + i + 4, _mm_unpackhi_epi16(shorts, zero), scale, lower);
+			}
+			break;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			for (; i + 8 <= n; i += 8)
+			{
+				const __m128i shorts = _mm_loadu_si128(v + i / 8);
+				store(dst + i, _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16), scale, lower);
+				store(dst + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(shorts, shorts), 16), scale, lower);
+			}
+			break;
+		default:
+			break;
+	}
+#endif
+
+	const size_t size = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(componentType)));
+	for (; i < n; i++)
+	{
+		dst[i] = component(src + i * size, componentType, c);
+	}
+}
+
+bool isIndexType(const int componentType)
+{
+	return componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE
+		|| componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+		|| componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+}
+
+uint32_t index(const unsigned char * const p, const int componentType)
+{
+	switch (componentType)
+	{
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return *p;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+		default:
+		{
+			uint32_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+	}
+}
+}// namespace
+
+AccessorReader::AccessorReader(const tinygltf::Model & model)
+	: model_{model}
+{
+}
+
+float AccessorReader::convertValue(const double value, const int componentType, const bool normalized)
+{
+	const Conversion c = conversion(componentType, normalized);
+	return std::max(static_cast<float>(value) * c.scale, c.lower);
+}
+
+size_t AccessorReader::count(const int accessor) const
+{
+	return accessor >= 0 && static_cast<size_t>(accessor) < model_.accessors.size() ? model_.accessors[accessor].count : 0;
+}
+
+bool AccessorReader::readFloats(const int accessor, const int components, float * const out, const size_t outStride) const
+{
+	if (accessor < 0 || static_cast<size_t>(accessor) >= model_.accessors.size())
+	{
+		return false;
+	}
+
+	const auto & gltfAccessor = model_.accessors[accessor];
+	Source dense;
+	if (!source(gltfAccessor, dense))
+	{
+		std::cerr << "Invalid accessor: " << accessor << std::endl;
+		return false;
+	}
+
+	decode(dense, 0, gltfAccessor.count, components, out, outStride);
+	return !gltfAccessor.sparse.isSparse || applySparse(gltfAccessor, components, out, outStride);
+}
+
+bool AccessorReader::readIndices(const int accessor, uint32_t * const out) const
+{
+	const unsigned char * data = nullptr;
+	int type = 0;
+	if (!indexSource(accessor, data, type))
+	{
+		return false;
+	}
+
+	const size_t n = model_.accessors[accessor].count;
+	const size_t size = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(type)));
+	size_t i = 0;
+	if (type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+	{
+		std::memcpy(out, data, n * sizeof(uint32_t));
+		return true;
+	}
+
+#ifdef ACCESSOR_READER_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const auto * const v = reinterpret_cast<const __m128i *>(data);
+	auto * const dst = reinterpret_cast<__m128i *>(out);
+	if (type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+	{
+		for (; i + 8 <= n; i += 8)
+		{
+			const __m128i shorts = _mm_loadu_si128(v + i / 8);
+			_mm_storeu_si128(dst + i / 4, _mm_unpacklo_epi16(shorts, zero));
+			_mm_storeu_si128(dst + i / 4 + 1, _mm_unpackhi_epi16(shorts, zero));
+		}
+	}
+	else
+	{
+		for (; i + 16 <= n; i += 16)
+		{
+			const __m128i bytes = _mm_loadu_si128(v + i / 16);
+			const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+			const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+			_mm_storeu_si128(dst + i / 4, _mm_unpacklo_epi16(lo, zero));
+			_mm_storeu_si128(dst + i / 4 + 1, _mm_unpackhi_epi16(lo, zero));
+			_mm_storeu_si128(dst + i / 4 + 2, _mm_unpacklo_epi16(hi, zero));
+			_mm_storeu_si128(dst + i / 4 + 3, _mm_unpackhi_epi16(hi, zero));
+		}
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		out[i] = index(data + i * size, type);
+	}
+	return true;
+}
+
+bool AccessorReader::readIndices(const int accessor, uint16_t * const out) const
+{
+	const unsigned char * data = nullptr;
+	int type = 0;
+	if (!indexSource(accessor, data, type))
+	{
+		return false;
+	}
+
+	const size_t n = model_.accessors[accessor].count;
+	size_t i = 0;
+	if (type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+	{
+		std::memcpy(out, data, n * sizeof(uint16_t));
+		return true;
+	}
+
+	if (type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+	{
+		for (; i < n; i++)
+		{
+			const uint32_t value = index(data + i * sizeof(uint32_t), type);
+			if (value > UINT16_MAX)
+			{
+				std::cerr << "Index does not fit 16 bit in accessor: " << accessor << std::endl;
+				return false;
+			}
+			out[i] = static_cast<uint16_t>(value);
+		}
+		return true;
+	}
+
+#ifdef ACCESSOR_READER_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const auto * const v = reinterpret_cast<const __m128i *>(data);
+	auto * const dst = reinterpret_cast<__m128i *>(out);
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m128i bytes = _mm_loadu_si128(v + i / 16);
+		_mm_storeu_si128(dst + i / 8, _mm_unpacklo_epi8(bytes, zero));
+		_mm_storeu_si128(dst + i / 8 + 1, _mm_unpackhi_epi8(bytes, zero));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		out[i] = data[i];
+	}
+	return true;
+}
+
+bool AccessorReader::indexSource(const int accessor, const unsigned char *& data, int & componentType) const
+{
+	if (accessor < 0 || static_cast<size_t>(accessor) >= model_.accessors.size())
+	{
+		return false;
+	}
+
+	const auto & gltfAccessor = model_.accessors[accessor];
+	componentType = gltfAccessor.componentType;
+	const size_t size = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(componentType)));
+	if (!isIndexType(componentType) || gltfAccessor.sparse.isSparse
+		|| !view(gltfAccessor.bufferView, gltfAccessor.byteOffset, gltfAccessor.count, size, size, data))
+	{
+		std::cerr << "Unsupported index accessor: " << accessor << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool AccessorReader::view(const int bufferView, const size_t byteOffset, const size_t count, const size_t elementSize,
+						  const size_t stride, const unsigned char *& data) const
+{
+	if (bufferView < 0 || static_cast<size_t>(bufferView) >= model_.bufferViews.size())
+	{
+		return false;
+	}
+
+	const auto & gltfView = model_.bufferViews[bufferView];
+	if (gltfView.buffer < 0 || static_cast<size_t>(gltfView.buffer) >= model_.buffers.size())
+	{
+		return false;
+	}
+
+	// Every element has to lie inside the view, and the view inside its buffer.
+	const auto & buffer = model_.buffers[gltfView.buffer];
+	const size_t used = count == 0 ? 0 : byteOffset + (count - 1) * stride + elementSize;
+	if (used > gltfView.byteLength || gltfView.byteOffset + gltfView.byteLength > buffer.data.size())
+	{
+		return false;
+	}
+
+	data = buffer.data.data() + gltfView.byteOffset + byteOffset;
+	return true;
+}
+
+bool AccessorReader::source(const tinygltf::Accessor & accessor, Source & source) const
+{
+	source.componentType = accessor.componentType;
+	source.components = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+	source.normalized = accessor.normalized;
+
+	const int size = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+	if (size <= 0 || source.components <= 0)
+	{
+		return false;
+	}
+
+	const size_t elementSize = static_cast<size_t>(size) * static_cast<size_t>(source.components);
+	if (accessor.bufferView < 0)
+	{
+		// Only sparse accessors may omit the view, their base values are zero.
+		source.data = nullptr;
+		source.stride = elementSize;
+		return accessor.sparse.isSparse;
+	}
+
+	const int stride = accessor.ByteStride(model_.bufferViews[accessor.bufferView]);
+	source.stride = stride > 0 ? static_cast<size_t>(stride) : elementSize;
+	return view(accessor.bufferView, accessor.byteOffset, accessor.count, elementSize, source.stride, source.data);
+}
+
+bool AccessorReader::applySparse(const tinygltf::Accessor & accessor, const int components, float * const out,
+								 const size_t outStride) const
+{
+	const auto & sparse = accessor.sparse;
+	const auto count = static_cast<size_t>(sparse.count);
+	const int indexType = sparse.indices.componentType;
+	const size_t indexSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(indexType)));
+
+	const unsigned char * indices = nullptr;
+	Source values;
+	values.componentType = accessor.componentType;
+	values.components = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+	values.normalized = accessor.normalized;
+	values.stride = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType)))
+		* static_cast<size_t>(values.components);
+
+	if (!isIndexType(indexType)
+		|| !view(sparse.indices.bufferView, sparse.indices.byteOffset, count, indexSize, indexSize, indices)
+		|| !view(sparse.values.bufferView, sparse.values.byteOffset, count, values.stride, values.stride, values.data))
+	{
+		std::cerr << "Invalid sparse accessor" << std::endl;
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint32_t target = index(indices + i * indexSize, indexType);
+		if (target >= accessor.count)
+		{
+			std::cerr << "Sparse index out of range: " << target << std::endl;
+			return false;
+		}
+		decode(values, i, 1, components, out + target * outStride, outStride);
+	}
+	return true;
+}
+
+void AccessorReader::decode(const Source & source, const size_t first, const size_t count, const int components,
+							float * const out, const size_t outStride)
+{
+	const auto n = static_cast<size_t>(std::min(components, source.components));
+	const auto sourceComponents = static_cast<size_t>(source.components);
+	if (source.data == nullptr)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			std::fill_n(out + i * outStride, n, 0.0f);
+		}
+		return;
+	}
+
+	const Conversion c = conversion(source.componentType, source.normalized);
+	const size_t size = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(source.componentType)));
+	const unsigned char * const data = source.data + first * source.stride;
+
+	if (source.stride != size * sourceComponents)
+	{
+		// Interleaved source: component by component.
+		for (size_t i = 0; i < count; i++)
+		{
+			for (size_t k = 0; k < n; k++)
+			{
+				out[i * outStride + k] = component(data + i * source.stride + k * size, source.componentType, c);
+			}
+		}
+		return;
+	}
+
+	if (outStride == sourceComponents && n == sourceComponents)
+	{
+		convert(data, count * sourceComponents, source.componentType, c, out);
+		return;
+	}
+
+	// Tightly packed source into an interleaved destination: convert in blocks, then scatter.
+	constexpr size_t BLOCK = 1024;
+	float block[BLOCK];
+	const size_t tuplesPerBlock = BLOCK / sourceComponents;
+	for (size_t i = 0; i < count; i += tuplesPerBlock)
+	{
+		const size_t tuples = std::min(tuplesPerBlock, count - i);
+		convert(data + i * sourceComponents * size, tuples * sourceComponents, source.componentType, c, block);
+		for (size_t t = 0; t < tuples; t++)
+		{
+			std::copy_n(block + t * sourceComponents, n, out + (i + t) * outStride);
+		}
+	}
+}
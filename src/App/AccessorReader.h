@@ -0,0 +1,50 @@
+#pragma once
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// Decodes glTF accessors of any component type, byte stride and sparsity.
+// Tightly packed sources are converted with SIMD kernels where available.
+class AccessorReader
+{
+public:
+	explicit AccessorReader(const tinygltf::Model & model);
+
+	// Writes count tuples of `components` floats, one every outStride floats.
+	// Normalized integers map to [0, 1] or [-1, 1], others convert as is (KHR_mesh_quantization).
+	// Source components beyond `components` are dropped, missing ones are left untouched.
+	[[nodiscard]] bool readFloats(int accessor, int components, float * out, size_t outStride) const;
+	// Any unsigned index type, widened to 32 bit.
+	[[nodiscard]] bool readIndices(int accessor, uint32_t * out) const;
+	// Any unsigned index type as 16 bit, fails if a 32 bit index does not fit.
+	[[nodiscard]] bool readIndices(int accessor, uint16_t * out) const;
+
+	[[nodiscard]] size_t count(int accessor) const;
+
+	// Converts one stored component the way readFloats does, e.g. an accessor's min or max.
+	[[nodiscard]] static float convertValue(double value, int componentType, bool normalized);
+
+private:
+	// Where the tuples of a dense accessor, or the values of a sparse one, live.
+	struct Source
+	{
+		const unsigned char * data = nullptr;// nullptr: all zero
+		size_t stride = 0;
+		int componentType = 0;
+		int components = 0;
+		bool normalized = false;
+	};
+
+	[[nodiscard]] bool view(int bufferView, size_t byteOffset, size_t count, size_t elementSize, size_t stride,
+							const unsigned char *& data) const;
+	[[nodiscard]] bool source(const tinygltf::Accessor & accessor, Source & source) const;
+	// Tightly packed data of an index accessor, sparse ones are not supported.
+	[[nodiscard]] bool indexSource(int accessor, const unsigned char *& data, int & componentType) const;
+	[[nodiscard]] bool applySparse(const tinygltf::Accessor & accessor, int components, float * out, size_t outStride) const;
+
+	static void decode(const Source & source, size_t first, size_t count, int components, float * out, size_t outStride);
+
+	const tinygltf::Model & model_;
+};
@@ -0,0 +1,141 @@
+#include "AssetLoader.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+AssetLoader::AssetLoader(const AssetLoaderSettings & settings)
+	: settings_{settings}
+{
+	for (size_t i = 0; i < std::max<size_t>(settings_.threadCount, 1); i++)
+	{
+		threads_.emplace_back(&AssetLoader::work, this);
+	}
+}
+
+AssetLoader::~AssetLoader()
+{
+	stop();
+}
+
+void AssetLoader::spawn(Task<void> task)
+{
+	const auto handle = task.handle_;
+	handle.promise().loader = this;
+	tasks_.push_back(std::move(task));
+	handle.resume();
+}
+
+void AssetLoader::pump()
+{
+	deadline_ = Clock::now() + settings_.frameBudget;
+
+	// Only work queued before this frame runs, a load that keeps yielding cannot hold the frame.
+	std::deque<std::coroutine_handle<>> ready;
+	{
+		const std::lock_guard lock{mutex_};
+		ready.swap(render_);
+	}
+	while (!ready.empty())
+	{
+		if (Clock::now() >= deadline_)
+		{
+			{
+				const std::lock_guard lock{mutex_};
+				render_.insert(render_.begin(), ready.begin(), ready.end());
+			}
+			requestPump();
+			break;
+		}
+		const auto handle = ready.front();
+		ready.pop_front();
+		handle.resume();
+	}
+
+	std::vector<std::coroutine_handle<>> finished;
+	{
+		const std::lock_guard lock{mutex_};
+		finished.swap(finished_);
+	}
+	const auto isFinished = [&finished](const Task<void> & task) {
+		return std::find(finished.begin(), finished.end(), task.handle_) != finished.end();
+	};
+	tasks_.erase(std::remove_if(tasks_.begin(), tasks_.end(), isFinished), tasks_.end());
+}
+
+void AssetLoader::stop()
+{
+	{
+		const std::lock_guard lock{mutex_};
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (auto & thread : threads_)
+	{
+		thread.join();
+	}
+	threads_.clear();
+
+	// Every load is suspended now, destroying a spawned task destroys the tasks it awaits too.
+	background_.clear();
+	render_.clear();
+	finished_.clear();
+	tasks_.clear();
+}
+
+bool AssetLoader::pending() const
+{
+	return !tasks_.empty();
+}
+
+void AssetLoader::schedule(const std::coroutine_handle<> handle, const Queue queue)
+{
+	{
+		const std::lock_guard lock{mutex_};
+		(queue == Queue::Background ? background_ : render_).push_back(handle);
+	}
+	if (queue == Queue::Background)
+	{
+		wake_.notify_one();
+	}
+	else
+	{
+		requestPump();
+	}
+}
+
+void AssetLoader::requestPump() const
+{
+	if (settings_.requestPump)
+	{
+		settings_.requestPump();
+	}
+}
+
+void AssetLoader::finished(const std::coroutine_handle<> handle)
+{
+	{
+		const std::lock_guard lock{mutex_};
+		finished_.push_back(handle);
+	}
+	requestPump();
+}
+
+void AssetLoader::work()
+{
+	Profiler::setThreadName("asset loader");
+	for (;;)
+	{
+		std::coroutine_handle<> handle;
+		{
+			std::unique_lock lock{mutex_};
+			wake_.wait(lock, [this] { return stop_ || !background_.empty(); });
+			if (stop_)
+			{
+				return;
+			}
+			handle = background_.front();
+			background_.pop_front();
+		}
+		handle.resume();
+	}
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct AssetLoaderSettings
+{
+	// Threads running the background part of loads: file I/O, parsing, cooking.
+	size_t threadCount = 2;
+	// Render thread time per frame given to loads, the rest resumes in the next frame.
+	std::chrono::microseconds frameBudget{2000};
+	// Bytes a load uploads between two budget checks.
+	size_t uploadChunk = 1 << 20;
+	// Called, on any thread, whenever work for pump() gets queued, so the window can draw a frame for it.
+	std::function<void()> requestPump;
+};
+
+// Streams assets in with C++20 coroutines, so the window draws its first frame right away.
+// A load is a Task that moves itself between threads: co_await background() continues on a worker,
+// co_await renderThread() continues in the next pump(), and co_await slice() between GL uploads
+// defers the rest of the work to the next frame once the frame's budget is spent.
+class AssetLoader
+{
+public:
+	template<typename T>
+	class Task;
+
+	explicit AssetLoader(const AssetLoaderSettings & settings = {});
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader &) = delete;
+	AssetLoader & operator=(const AssetLoader &) = delete;
+
+	// Starts a load on the calling thread, the loader owns it until it finishes. Render thread only.
+	void spawn(Task<void> task);
+	// Resumes the render thread part of loads until the frame budget runs out.
+	// Call once per frame, with the GL context current.
+	void pump();
+	// Joins the workers and drops every unfinished load. Call before destroying what loads write to.
+	void stop();
+
+	// Whether any spawned load is still running.
+	[[nodiscard]] bool pending() const;
+	[[nodiscard]] size_t uploadChunk() const { return settings_.uploadChunk; }
+
+	[[nodiscard]] auto background() { return Switch{*this, Queue::Background}; }
+	[[nodiscard]] auto renderThread() { return Switch{*this, Queue::Render}; }
+	// Continues right away while the frame has budget left, otherwise in the next frame. Render thread only.
+	[[nodiscard]] auto slice() { return Slice{*this}; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Queue
+	{
+		Background,
+		Render
+	};
+
+	struct Switch
+	{
+		AssetLoader & loader;
+		Queue queue;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle) const { loader.schedule(handle, queue); }
+		void await_resume() const noexcept {}
+	};
+
+	struct Slice
+	{
+		AssetLoader & loader;
+
+		bool await_ready() const noexcept { return Clock::now() < loader.deadline_; }
+		void await_suspend(std::coroutine_handle<> handle) const { loader.schedule(handle, Queue::Render); }
+		void await_resume() const noexcept {}
+	};
+
+	void schedule(std::coroutine_handle<> handle, Queue queue);
+	void requestPump() const;
+	void finished(std::coroutine_handle<> handle);
+	void work();
+
+	AssetLoaderSettings settings_;
+	std::vector<std::thread> threads_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	std::deque<std::coroutine_handle<>> background_;
+	std::deque<std::coroutine_handle<>> render_;
+	std::vector<std::coroutine_handle<>> finished_;
+	bool stop_ = false;
+
+	// Render thread only.
+	std::vector<Task<void>> tasks_;
+	Clock::time_point deadline_;
+};
+
+namespace asset_loader_detail
+{
+template<typename T>
+struct Result
+{
+	std::optional<T> value;
+
+	void return_value(T result) { value = std::move(result); }
+	T take() { return std::move(*value); }
+};
+
+template<>
+struct Result<void>
+{
+	void return_void() {}
+	void take() {}
+};
+}// namespace asset_loader_detail
+
+// Lazily started coroutine. Awaiting it runs it and resumes the awaiter with its result,
+// on whichever thread the task finished on.
+template<typename T>
+class AssetLoader::Task
+{
+public:
+	struct promise_type : asset_loader_detail::Result<T>
+	{
+		std::coroutine_handle<> continuation;
+		AssetLoader * loader = nullptr;// set for spawned tasks, told when they finish
+
+		Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		auto final_suspend() noexcept { return Final{}; }
+		// Loads report failures through std::cerr and their result, never by throwing.
+		void unhandled_exception() { std::terminate(); }
+	};
+
+	Task() = default;
+	Task(Task && other) noexcept
+		: handle_{std::exchange(other.handle_, {})}
+	{
+	}
+	Task & operator=(Task && other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			handle_ = std::exchange(other.handle_, {});
+		}
+		return *this;
+	}
+	~Task() { reset(); }
+
+	auto operator co_await() && noexcept { return Await{handle_}; }
+
+private:
+	friend class AssetLoader;
+
+	struct Final
+	{
+		bool await_ready() const noexcept { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) const noexcept
+		{
+			auto & promise = handle.promise();
+			if (promise.continuation)
+			{
+				return promise.continuation;
+			}
+			// The loader may destroy the frame as soon as it knows, nothing here touches it afterwards.
+			if (promise.loader != nullptr)
+			{
+				promise.loader->finished(handle);
+			}
+			return std::noop_coroutine();
+		}
+		void await_resume() const noexcept {}
+	};
+
+	struct Await
+	{
+		std::coroutine_handle<promise_type> handle;
+
+		bool await_ready() const noexcept { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) const noexcept
+		{
+			handle.promise().continuation = awaiter;
+			return handle;
+		}
+		T await_resume() const { return handle.promise().take(); }
+	};
+
+	explicit Task(std::coroutine_handle<promise_type> handle)
+		: handle_{handle}
+	{
+	}
+
+	void reset()
+	{
+		if (handle_)
+		{
+			handle_.destroy();
+			handle_ = {};
+		}
+	}
+
+	std::coroutine_handle<promise_type> handle_;
+};
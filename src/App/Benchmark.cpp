@@ -0,0 +1,142 @@
+#include "Benchmark.h"
+#include "FrameStats.h"
+#include "GpuProfiler.h"
+#include "Window.h"
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+// Frames rendered while waiting for the assets, after which the run gives up.
+constexpr size_t MAX_LOADING_FRAMES = 100000;
+}// namespace
+
+Benchmark::Benchmark(const BenchmarkSettings & settings)
+	: settings_{settings}
+{
+}
+
+bool Benchmark::run()
+{
+	QOffscreenSurface surface;
+	surface.setFormat(QSurfaceFormat::defaultFormat());
+	surface.create();
+	QOpenGLContext context;
+	context.setFormat(QSurfaceFormat::defaultFormat());
+	if (!context.create() || !context.makeCurrent(&surface))
+	{
+		std::cerr << "Failed to create an offscreen OpenGL context" << std::endl;
+		return false;
+	}
+	QOpenGLFunctions & gl = *context.functions();
+
+	GLint maxSamples = 0;
+	gl.glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	const int samples = std::clamp(settings_.samples, 0, static_cast<int>(maxSamples));
+	if (samples != settings_.samples)
+	{
+		std::cerr << "MSAA limited to " << samples << " samples" << std::endl;
+	}
+
+	// Multisampled target, resolved every frame like QOpenGLWidget does before presenting.
+	QOpenGLFramebufferObjectFormat format;
+	format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	format.setSamples(samples);
+	QOpenGLFramebufferObject target(settings_.width, settings_.height, format);
+	QOpenGLFramebufferObject resolved(settings_.width, settings_.height);
+	if (!target.isValid() || !resolved.isValid())
+	{
+		std::cerr << "Failed to create a " << settings_.width << "x" << settings_.height << " framebuffer" << std::endl;
+		return false;
+	}
+
+	// Never shown, so it draws with this context and never paints itself.
+	Window window;
+	window.initializeOpenGLFunctions();
+	target.bind();
+	window.onInit();
+	window.onResize(static_cast<size_t>(settings_.width), static_cast<size_t>(settings_.height));
+
+	// glFinish makes a frame's time include the GPU work it queued.
+	const auto renderFrame = [&] {
+		target.bind();
+		window.onRender();
+		if (samples != 0)
+		{
+			QOpenGLFramebufferObject::blitFramebuffer(&resolved, &target);
+		}
+		gl.glFinish();
+	};
+
+	size_t loadingFrames = 0;
+	for (; window.loading() && loadingFrames < MAX_LOADING_FRAMES; loadingFrames++)
+	{
+		renderFrame();
+	}
+	if (window.loading())
+	{
+		std::cerr << "Assets did not finish loading" << std::endl;
+		return false;
+	}
+	for (size_t i = 0; i < settings_.warmupFrames; i++)
+	{
+		renderFrame();
+	}
+
+	FrameStatsSettings statsSettings;
+	statsSettings.capacity = settings_.frames;
+	FrameStats frameStats(statsSettings);
+	QElapsedTimer timer;
+	for (size_t i = 0; i < settings_.frames; i++)
+	{
+		timer.start();
+		renderFrame();
+		frameStats.record(static_cast<float>(timer.nsecsElapsed()) / 1.0e6f);
+	}
+	const FrameSummary summary = frameStats.summary();
+	if (summary.frames == 0)
+	{
+		std::cerr << "No frames to measure" << std::endl;
+		return false;
+	}
+
+	// GPU results lag a few frames behind, the last few warm-up frames stand in for the newest timed ones.
+	FrameStats::Series series{{"cpu", &frameStats}};
+	QJsonObject gpuTimes;
+	for (const auto & [name, stats] : window.gpuProfiler().stats())
+	{
+		series.emplace_back(QString::fromStdString("gpu." + name), &stats);
+		gpuTimes[QString::fromStdString(name)] = stats.summary(settings_.frames).toJson();
+	}
+	if (!settings_.frameStatsPath.isEmpty() && !FrameStats::save(settings_.frameStatsPath, series, settings_.frames))
+	{
+		return false;
+	}
+
+	QJsonObject result;
+	result["renderer"] = QString(reinterpret_cast<const char *>(gl.glGetString(GL_RENDERER)));
+	result["version"] = QString(reinterpret_cast<const char *>(gl.glGetString(GL_VERSION)));
+	result["width"] = settings_.width;
+	result["height"] = settings_.height;
+	result["samples"] = samples;
+	result["frames"] = static_cast<qint64>(summary.frames);
+	result["warmupFrames"] = static_cast<qint64>(settings_.warmupFrames);
+	result["loadingFrames"] = static_cast<qint64>(loadingFrames);
+	result["fps"] = 1000.0f / summary.mean;
+	result["frameTimeMs"] = summary.toJson();
+	result["gpuTimeMs"] = gpuTimes;
+	result["gpuDroppedFrames"] = static_cast<qint64>(window.gpuProfiler().droppedFrames());
+	std::cout << QJsonDocument(result).toJson(QJsonDocument::Indented).constData() << std::flush;
+
+	// The window releases its resources with this context current.
+	return true;
+}
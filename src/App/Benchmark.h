@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QString>
+
+#include <cstddef>
+
+struct BenchmarkSettings
+{
+	size_t frames = 500;
+	// Frames rendered, untimed, after the assets finished loading.
+	size_t warmupFrames = 50;
+	int width = 1280;
+	int height = 720;
+	// MSAA samples of the render target, clamped to what the driver supports. 0 renders without MSAA.
+	int samples = 4;
+	// Also write every timed frame there, see FrameStats::save.
+	QString frameStatsPath;
+};
+
+// Renders the scene of a Window that is never shown into an offscreen framebuffer, a fixed number of frames,
+// and prints frame time statistics as JSON to stdout. Works with QT_QPA_PLATFORM=offscreen and software GL.
+// stdout carries nothing else, the app logs to stderr, so the output parses as is.
+class Benchmark
+{
+public:
+	explicit Benchmark(const BenchmarkSettings & settings = {});
+
+	// Needs the QApplication and QSurfaceFormat::defaultFormat() of the app. Returns false if GL is unavailable.
+	[[nodiscard]] bool run();
+
+private:
+	BenchmarkSettings settings_;
+};
@@ -0,0 +1,337 @@
+#include "CookedScene.h"
+#include "Profiler.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstring>
+#include <iostream>
+
+// Sections follow at DATA_OFFSET, each at a 16 byte boundary: vertices, indices, draws, materials,
+// the image table and the image bytes. Everything is stored in native byte order.
+struct CookedScene::Header
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t drawCount;
+	uint32_t materialCount;
+	uint32_t imageCount;
+	uint32_t defaultScene;
+	uint64_t vertexOffset;
+	uint64_t vertexBytes;
+	uint64_t indexOffset;
+	uint64_t indexBytes;
+	uint64_t drawOffset;
+	uint64_t materialOffset;
+	uint64_t imageOffset;
+	uint64_t fileSize;
+};
+
+struct CookedScene::Draw
+{
+	float world[16];// column-major
+	float boundsMin[3];
+	float boundsMax[3];
+	uint32_t scene;
+	uint32_t primitive;
+	uint32_t baseVertex;
+	uint32_t vertexCount;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t indexType;
+	int32_t material;
+};
+
+struct CookedScene::Material
+{
+	float baseColorFactor[4];
+	int32_t baseColorImage;
+	uint32_t minFilter;
+	uint32_t magFilter;
+	uint32_t wrapS;
+	uint32_t wrapT;
+	float anisotropy;
+};
+
+struct CookedScene::Image
+{
+	uint64_t offset;
+	uint64_t byteLength;
+	char mimeType[32];
+};
+
+namespace
+{
+constexpr size_t DATA_OFFSET = 128;
+constexpr size_t DATA_ALIGNMENT = 16;
+
+constexpr size_t alignUp(const size_t value, const size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool inside(const uint64_t offset, const uint64_t bytes, const uint64_t fileSize)
+{
+	return offset <= fileSize && bytes <= fileSize - offset;
+}
+
+void addBytes(uint64_t & hash, const void * const data, const size_t size)
+{
+	// FNV-1a, stable across runs and platforms
+	const auto * const bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+}
+}// namespace
+
+bool CookedScene::cook(const QString & gltfPath, const QString & path)
+{
+	const ProfileZone zone("scene.cook");
+
+	// Cooking happens once per source, so it can afford the mesh optimization.
+	SceneLoaderSettings settings;
+	settings.optimizeMeshes = true;
+	Scene scene;
+	SceneLoader loader{settings};
+	if (!loader.load(gltfPath, scene, SceneLayout::Interleaved, SceneImages::Deferred) || !write(scene, path))
+	{
+		std::cerr << "Failed to cook scene: " << gltfPath.toStdString() << std::endl;
+		return false;
+	}
+	std::cerr << "Cooked scene: " << gltfPath.toStdString() << " -> " << path.toStdString() << std::endl;
+	return true;
+}
+
+bool CookedScene::write(const Scene & scene, const QString & path)
+{
+	static_assert(sizeof(Header) <= DATA_OFFSET);
+	if (!scene.bindings.empty() || scene.layout.stride != 8 * sizeof(GLfloat))
+	{
+		std::cerr << "Only packed scenes can be cooked" << std::endl;
+		return false;
+	}
+
+	Header header{};
+	std::memcpy(header.magic, "SCNK", sizeof(header.magic));
+	header.version = VERSION;
+	header.drawCount = static_cast<uint32_t>(scene.draws.size());
+	header.materialCount = static_cast<uint32_t>(scene.materials.size());
+	header.imageCount = static_cast<uint32_t>(scene.images.size());
+	header.defaultScene = static_cast<uint32_t>(scene.defaultScene);
+
+	header.vertexOffset = DATA_OFFSET;
+	header.vertexBytes = scene.vertices.size() * sizeof(GLfloat);
+	header.indexOffset = alignUp(header.vertexOffset + header.vertexBytes, DATA_ALIGNMENT);
+	header.indexBytes = scene.indexData.size();
+	header.drawOffset = alignUp(header.indexOffset + header.indexBytes, DATA_ALIGNMENT);
+	header.materialOffset = alignUp(header.drawOffset + scene.draws.size() * sizeof(Draw), DATA_ALIGNMENT);
+	header.imageOffset = alignUp(header.materialOffset + scene.materials.size() * sizeof(Material), DATA_ALIGNMENT);
+
+	std::vector<Image> images(scene.images.size());
+	size_t end = header.imageOffset + images.size() * sizeof(Image);
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		images[i].offset = alignUp(end, DATA_ALIGNMENT);
+		images[i].byteLength = scene.imageBytes(i).size();
+		std::strncpy(images[i].mimeType, scene.images[i].mimeType.c_str(), sizeof(images[i].mimeType) - 1);
+		end = images[i].offset + images[i].byteLength;
+	}
+	header.fileSize = end;
+
+	std::vector<unsigned char> blob(end, 0);
+	std::memcpy(blob.data(), &header, sizeof(header));
+	std::memcpy(blob.data() + header.vertexOffset, scene.vertices.data(), header.vertexBytes);
+	std::memcpy(blob.data() + header.indexOffset, scene.indexData.data(), header.indexBytes);
+
+	auto * const draws = reinterpret_cast<Draw *>(blob.data() + header.drawOffset);
+	for (size_t i = 0; i < scene.draws.size(); i++)
+	{
+		const DrawRecord & draw = scene.draws[i];
+		Draw & out = draws[i];
+		std::memcpy(out.world, draw.world.constData(), sizeof(out.world));
+		out.boundsMin[0] = draw.boundsMin.x();
+		out.boundsMin[1] = draw.boundsMin.y();
+		out.boundsMin[2] = draw.boundsMin.z();
+		out.boundsMax[0] = draw.boundsMax.x();
+		out.boundsMax[1] = draw.boundsMax.y();
+		out.boundsMax[2] = draw.boundsMax.z();
+		out.scene = static_cast<uint32_t>(draw.scene);
+		out.primitive = draw.primitive;
+		out.baseVertex = static_cast<uint32_t>(draw.baseVertex);
+		out.vertexCount = static_cast<uint32_t>(draw.vertexCount);
+		out.firstIndex = static_cast<uint32_t>(draw.firstIndex);
+		out.indexCount = static_cast<uint32_t>(draw.indexCount);
+		out.indexType = draw.indexType;
+		out.material = draw.material;
+	}
+
+	auto * const materials = reinterpret_cast<Material *>(blob.data() + header.materialOffset);
+	for (size_t i = 0; i < scene.materials.size(); i++)
+	{
+		const SceneMaterial & material = scene.materials[i];
+		Material & out = materials[i];
+		out.baseColorFactor[0] = material.baseColorFactor.x();
+		out.baseColorFactor[1] = material.baseColorFactor.y();
+		out.baseColorFactor[2] = material.baseColorFactor.z();
+		out.baseColorFactor[3] = material.baseColorFactor.w();
+		out.baseColorImage = material.baseColorImage;
+		out.minFilter = material.baseColorSampler.minFilter;
+		out.magFilter = material.baseColorSampler.magFilter;
+		out.wrapS = material.baseColorSampler.wrapS;
+		out.wrapT = material.baseColorSampler.wrapT;
+		out.anisotropy = material.baseColorSampler.anisotropy;
+	}
+
+	std::memcpy(blob.data() + header.imageOffset, images.data(), images.size() * sizeof(Image));
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		const auto bytes = scene.imageBytes(i);
+		std::memcpy(blob.data() + images[i].offset, bytes.data(), bytes.size());
+	}
+
+	if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+	{
+		return false;
+	}
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly)
+		|| file.write(reinterpret_cast<const char *>(blob.data()), static_cast<qint64>(blob.size())) != static_cast<qint64>(blob.size())
+		|| !file.commit())
+	{
+		std::cerr << "Failed to write cooked scene: " << path.toStdString() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CookedScene::load(const QString & path, Scene & scene)
+{
+	const ProfileZone zone("scene.loadCooked");
+
+	// The scene keeps the file, and with it the mapping, alive.
+	auto file = std::make_shared<QFile>(path);
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+	const auto fileSize = static_cast<uint64_t>(file->size());
+	const unsigned char * const data = fileSize >= DATA_OFFSET ? file->map(0, file->size()) : nullptr;
+	if (data == nullptr)
+	{
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	const bool valid = std::memcmp(header.magic, "SCNK", sizeof(header.magic)) == 0 && header.version == VERSION
+		&& header.fileSize == fileSize
+		&& inside(header.vertexOffset, header.vertexBytes, fileSize)
+		&& inside(header.indexOffset, header.indexBytes, fileSize)
+		&& inside(header.drawOffset, uint64_t{header.drawCount} * sizeof(Draw), fileSize)
+		&& inside(header.materialOffset, uint64_t{header.materialCount} * sizeof(Material), fileSize)
+		&& inside(header.imageOffset, uint64_t{header.imageCount} * sizeof(Image), fileSize);
+	if (!valid)
+	{
+		std::cerr << "Ignoring stale cooked scene: " << path.toStdString() << std::endl;
+		return false;
+	}
+
+	scene = {};
+	scene.layout.add(0, GL_FLOAT, 3).add(1, GL_FLOAT, 3).add(2, GL_FLOAT, 2);
+	scene.buffers.emplace_back(data, fileSize);
+	scene.storage.push_back(file);
+
+	// Vertices and indices are uploaded as two views, drawn through one set of bindings.
+	const size_t vertexCount = header.vertexBytes / scene.layout.stride;
+	scene.views.push_back({0, header.vertexOffset, header.vertexBytes, GL_ARRAY_BUFFER});
+	scene.views.push_back({header.indexBytes != 0 ? 0 : -1, header.indexOffset, header.indexBytes, GL_ELEMENT_ARRAY_BUFFER});
+	ViewBindings & bindings = scene.bindings.emplace_back();
+	for (const auto & attribute : scene.layout.attributes)
+	{
+		bindings.attributes.push_back({attribute, 0, scene.layout.stride});
+	}
+	bindings.indexView = header.indexBytes != 0 ? 1 : -1;
+
+	for (uint32_t i = 0; i < header.materialCount; i++)
+	{
+		Material material;
+		std::memcpy(&material, data + header.materialOffset + i * sizeof(Material), sizeof(Material));
+		SceneMaterial & out = scene.materials.emplace_back();
+		out.baseColorFactor = QVector4D(material.baseColorFactor[0], material.baseColorFactor[1], material.baseColorFactor[2],
+										material.baseColorFactor[3]);
+		out.baseColorImage = material.baseColorImage < static_cast<int32_t>(header.imageCount) ? material.baseColorImage : -1;
+		out.baseColorSampler = {material.minFilter, material.magFilter, material.wrapS, material.wrapT, material.anisotropy};
+	}
+
+	for (uint32_t i = 0; i < header.imageCount; i++)
+	{
+		Image image;
+		std::memcpy(&image, data + header.imageOffset + i * sizeof(Image), sizeof(Image));
+		SceneImage & out = scene.images.emplace_back();
+		if (inside(image.offset, image.byteLength, fileSize))
+		{
+			out.mimeType.assign(image.mimeType, strnlen(image.mimeType, sizeof(image.mimeType)));
+			out.buffer = 0;
+			out.byteOffset = image.offset;
+			out.byteLength = image.byteLength;
+		}
+	}
+
+	for (uint32_t i = 0; i < header.drawCount; i++)
+	{
+		Draw draw;
+		std::memcpy(&draw, data + header.drawOffset + i * sizeof(Draw), sizeof(Draw));
+		const bool indexTypeValid = draw.indexType == GL_UNSIGNED_SHORT || draw.indexType == GL_UNSIGNED_INT;
+		// glTF modes are the GL primitives GL_POINTS (0) to GL_TRIANGLE_FAN (6), -1 means no material.
+		const bool drawValid = draw.primitive <= GL_TRIANGLE_FAN
+			&& uint64_t{draw.baseVertex} + draw.vertexCount <= vertexCount
+			&& (draw.indexCount == 0
+				|| (indexTypeValid
+					&& (uint64_t{draw.firstIndex} + draw.indexCount) * Geometry::typeSize(draw.indexType) <= header.indexBytes))
+			&& draw.material >= -1 && draw.material < static_cast<int32_t>(header.materialCount);
+		if (!drawValid)
+		{
+			std::cerr << "Skipping invalid draw " << i << " in cooked scene: " << path.toStdString() << std::endl;
+			continue;
+		}
+
+		DrawRecord & out = scene.draws.emplace_back();
+		out.world = QMatrix4x4(draw.world).transposed();
+		out.boundsMin = QVector3D(draw.boundsMin[0], draw.boundsMin[1], draw.boundsMin[2]);
+		out.boundsMax = QVector3D(draw.boundsMax[0], draw.boundsMax[1], draw.boundsMax[2]);
+		out.scene = draw.scene;
+		out.primitive = draw.primitive;
+		out.baseVertex = draw.baseVertex;
+		out.vertexCount = draw.vertexCount;
+		out.firstIndex = draw.firstIndex;
+		out.indexCount = draw.indexCount;
+		out.indexType = draw.indexType;
+		out.material = draw.material;
+		out.bindings = 0;
+	}
+	scene.defaultScene = header.defaultScene;
+
+	return !scene.draws.empty();
+}
+
+QString CookedScene::cachePath(const QString & source)
+{
+	const QFileInfo info(source);
+	const std::string name = source.toStdString();
+	const qint64 size = info.size();
+	const qint64 modified = info.lastModified().isValid() ? info.lastModified().toMSecsSinceEpoch() : 0;
+
+	uint64_t hash = 14695981039346656037ull;
+	addBytes(hash, name.data(), name.size());
+	addBytes(hash, &size, sizeof(size));
+	addBytes(hash, &modified, sizeof(modified));
+
+	const QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	return QDir(root).filePath(QString("scene-v%1-%2.cooked").arg(VERSION).arg(hash, 16, 16, QChar('0')));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "SceneLoader.h"
+
+#include <QString>
+
+#include <cstdint>
+
+// GPU-ready binary form of a packed Scene: the final vertex and index bytes, draws with bounds,
+// materials and encoded images. Loading maps the file and parses nothing, the scene's buffers
+// and images point straight into the mapping.
+class CookedScene
+{
+public:
+	// Bump whenever the file layout, the packed vertex layout or what cooking does to the data change.
+	static constexpr uint32_t VERSION = 3;
+
+	// Loads a glTF file packed, optimized and with deferred images, and writes its cooked form.
+	static bool cook(const QString & gltfPath, const QString & path);
+	// Only packed scenes, SceneLayout::Interleaved, can be written.
+	static bool write(const Scene & scene, const QString & path);
+	// Maps a cooked file. Fails on a missing, stale or truncated file.
+	[[nodiscard]] static bool load(const QString & path, Scene & scene);
+
+	// Where the cooked form of a source file is cached, changes with the source's size and time stamp.
+	[[nodiscard]] static QString cachePath(const QString & source);
+
+private:
+	struct Header;
+	struct Draw;
+	struct Material;
+	struct Image;
+};
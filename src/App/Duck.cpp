@@ -1,171 +1,97 @@
 #include "Duck.h"
+#include "CookedScene.h"
+#include "Profiler.h"
 
 #include <array>
 #include <iostream>
 
 #include <QFile>
 #include <QMatrix4x4>
+#include <QOpenGLContext>
+
+Duck::Duck(const DuckSettings & settings)
+	: settings_{settings}
+{
+}
 
 void Duck::render(Window * const wnd, const QMatrix4x4 & viewProjection)
 {
-	// Bind VAO and shader program
+	const ProfileZone zone("duck.render");
+
+	// Bind shader program, each draw binds the VAO it reads from
 	program_->bind();
-	vao_.bind();
 
 	// Update uniform values
 	QMatrix4x4 scale;
 	// scale.setToIdentity();
-	scale.scale(0.1f);
-	program_->setUniformValue(mvpUniform_, viewProjection * scale);
-	program_->setUniformValue(timeUniform_, (float)clock() / CLOCKS_PER_SEC);
-	program_->setUniformValue(userPosUniform_, wnd->userPos_);
+	// The asset's root node already scales by 0.01.
+	scale.scale(10.0f);
+	{
+		const ProfileZone uniformsZone("duck.uniforms");
+		program_->setUniformValue(timeUniform_, wnd->animationTime());
+		program_->setUniformValue(userPosUniform_, wnd->userPos_);
 
-	program_->setUniformValue(dotLightAngleUniform_, wnd->dotLightAngle_);
-	program_->setUniformValue(dotLightHeightUniform_, wnd->dotLightHeight_);
-	program_->setUniformValue(enableDotLightUniform_, wnd->enableDotLight_);
-	program_->setUniformValue(spotLightLatitudeUniform_, wnd->spotLightLatitude_);
-	program_->setUniformValue(spotLightLongitudeUniform_, wnd->spotLightLongitude_);
-	program_->setUniformValue(enableSpotLightUniform_, wnd->enableSpotLight_);
+		program_->setUniformValue(dotLightAngleUniform_, wnd->dotLightAngle_);
+		program_->setUniformValue(dotLightHeightUniform_, wnd->dotLightHeight_);
+		program_->setUniformValue(enableDotLightUniform_, wnd->enableDotLight_);
+		program_->setUniformValue(spotLightLatitudeUniform_, wnd->spotLightLatitude_);
+		program_->setUniformValue(spotLightLongitudeUniform_, wnd->spotLightLongitude_);
+		program_->setUniformValue(enableSpotLightUniform_, wnd->enableSpotLight_);
+	}
 
-	// Activate texture unit and bind texture
+	// Textures finished since the last frame go to the GPU, draws use white until theirs arrives
+	textures_.upload();
 	wnd->glActiveTexture(GL_TEXTURE0);
-	texture_->bind();
 
 	// Draw
-	if (indexCount_ != 0)
-	{
-		wnd->glDrawElements(GL_TRIANGLES, indexCount_, GL_UNSIGNED_INT, nullptr);
-	}
-	else
+	const ProfileZone drawZone("duck.draw");
+	auto * const gl = QOpenGLContext::currentContext()->extraFunctions();
+	for (const auto & draw : draws_)
 	{
-		wnd->glDrawArrays(GL_TRIANGLES, 0, vertexCount_);
+		QOpenGLTexture * const texture = draw.material >= 0 && materialTextures_[draw.material] >= 0
+			? textures_.texture(static_cast<size_t>(materialTextures_[draw.material]))
+			: nullptr;
+		(texture != nullptr ? texture : whiteTexture_.get())->bind();
+		gl->glBindSampler(0, texture != nullptr ? materialSamplers_[draw.material] : 0);
+		buffers_.bind(draw);
+		program_->setUniformValue(mvpUniform_, viewProjection * scale * draw.world);
+		draw.draw(*gl);
 	}
 
 	// Release VAO and shader program
-	texture_->release();
-	vao_.release();
+	gl->glBindSampler(0, 0);
+	whiteTexture_->release();
+	buffers_.release();
 	program_->release();
 }
 
 void Duck::release()
 {
-	texture_.reset();
+	samplers_.destroy(*QOpenGLContext::currentContext()->extraFunctions());
+	whiteTexture_.reset();
+	textures_.release();
 	program_.reset();
+	buffers_.destroy();
 }
 
-void Duck::init(Window * const wnd)
+bool Duck::loading() const
+{
+	return textures_.pending();
+}
+
+void Duck::init(Window * const wnd, AssetLoader & loader)
 {
 	program_ = std::make_unique<QOpenGLShaderProgram>(wnd);
 	program_->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/Shaders/diffuse.vs");
 	program_->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/Shaders/diffuse.fs");
 	program_->link();
 
-	texture_ = std::make_unique<QOpenGLTexture>(QImage(":/Textures/Duck.png"));
-	texture_->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
-	texture_->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
-
-	// load model
-	tinygltf::TinyGLTF loader;
-	tinygltf::Model model;
-	std::string err, warn;
-	std::string filename = ":/Models/Duck.glb";
-
-	QFile modelFile = QFile(QString::fromStdString(filename));
-	if (!modelFile.open(QIODevice::ReadOnly))
-	{
-		return;
-	}
-
-	QByteArray modelData = modelFile.readAll();
-	modelFile.close();
-
-	if (modelData.isEmpty())
-	{
-		return;
-	}
-
-	bool res = loader.LoadBinaryFromMemory(&model, &err, &warn,
-										   reinterpret_cast<const unsigned char *>(modelData.constData()), modelData.size());
-
-	if (!res)
-	{
-		std::cout << "Failed to load gltf: " << filename << ": " << err << std::endl;
-		return;
-	}
-
-	std::cout << "Loaded gltf: " << filename << std::endl;
-
-	vao_.create();
-	vao_.bind();
-
-	vbo_.create();
-	vbo_.bind();
-
-	ibo_.create();
-
-	std::vector<GLfloat> vertices;
-	std::vector<GLuint> indices;
-
-	auto & mesh = model.meshes[0];
-	auto & primitive = mesh.primitives[0];
-
-	bool hasNormals = primitive.attributes.find("NORMAL") != primitive.attributes.end();
-	bool hasTexCoords = primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end();
-
-	int cnt = 3;
-	if (hasNormals)
-		cnt += 3;
-	if (hasTexCoords)
-		cnt += 2;
-
-	size_t vertexCount = model.accessors[primitive.attributes.at("POSITION")].count;
-	vertices.resize(vertexCount * cnt);
-
-	loadInterleavedData(model, primitive, vertices.data(), cnt, hasNormals);
-
-	if (primitive.indices >= 0)
-	{
-		loadIndices(model, primitive, indices);
-	}
-
-	vbo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	vbo_.allocate(vertices.data(), static_cast<int>(vertices.size() * sizeof(GLfloat)));
-
-	if (!indices.empty())
-	{
-		ibo_.bind();
-		ibo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
-		ibo_.allocate(indices.data(), static_cast<int>(indices.size() * sizeof(GLuint)));
-	}
+	QImage white(1, 1, QImage::Format_RGBA8888);
+	white.fill(Qt::white);
+	whiteTexture_ = std::make_unique<QOpenGLTexture>(white);
 
 	program_->bind();
 
-	int fullSize = cnt * sizeof(GLfloat);
-	int offset = 0;
-
-	// pos (location=0)
-	program_->enableAttributeArray(0);
-	program_->setAttributeBuffer(0, GL_FLOAT, offset, 3, fullSize);
-	offset += 3 * sizeof(GLfloat);
-
-	// norm (location=1)
-	if (hasNormals)
-	{
-		program_->enableAttributeArray(1);
-		program_->setAttributeBuffer(1, GL_FLOAT, offset, 3, fullSize);
-		offset += 3 * sizeof(GLfloat);
-	}
-
-	// tex (location=2)
-	if (hasTexCoords)
-	{
-		program_->enableAttributeArray(2);
-		program_->setAttributeBuffer(2, GL_FLOAT, offset, 2, fullSize);
-	}
-
-	vertexCount_ = vertexCount;
-	indexCount_ = indices.size();
-
 	mvpUniform_ = program_->uniformLocation("mvp");
 	timeUniform_ = program_->uniformLocation("time");
 	userPosUniform_ = program_->uniformLocation("userPos");
@@ -177,104 +103,79 @@ void Duck::init(Window * const wnd)
 	enableSpotLightUniform_ = program_->uniformLocation("enableSpotLight");
 
 	program_->release();
-	vao_.release();
-	vbo_.release();
 
-	if (!indices.empty())
-	{
-		ibo_.release();
-	}
+	// Each decoded texture needs a frame to upload it.
+	textures_.setOnReady([wnd] {
+		wnd->requestFrame();
+	});
+
+	// The model streams in, nothing is drawn until its buffers are complete.
+	loader.spawn(load(loader, wnd));
 }
 
-void Duck::loadInterleavedData(const tinygltf::Model & model,
-							  const tinygltf::Primitive & primitive,
-							  GLfloat * vertices, int cnt, bool hasNormals)
+AssetLoader::Task<void> Duck::load(AssetLoader & loader, Window * const wnd)
 {
-	auto & posAccessor = model.accessors[primitive.attributes.at("POSITION")];
-	auto & posView = model.bufferViews[posAccessor.bufferView];
-	auto & posBuffer = model.buffers[posView.buffer];
-	const float * posData = reinterpret_cast<const float *>(
-		posBuffer.data.data() + posView.byteOffset + posAccessor.byteOffset);
-
-	// pos
-	for (size_t i = 0; i < posAccessor.count; i++)
-	{
-		vertices[i * cnt + 0] = posData[i * 3 + 0];
-		vertices[i * cnt + 1] = posData[i * 3 + 1];
-		vertices[i * cnt + 2] = posData[i * 3 + 2];
-	}
-
-	// norm
-	if (primitive.attributes.find("NORMAL") != primitive.attributes.end())
-	{
-		auto & normAccessor = model.accessors[primitive.attributes.at("NORMAL")];
-		auto & normView = model.bufferViews[normAccessor.bufferView];
-		auto & normBuffer = model.buffers[normView.buffer];
-		const float * normData = reinterpret_cast<const float *>(
-			normBuffer.data.data() + normView.byteOffset + normAccessor.byteOffset);
-
-		for (size_t i = 0; i < normAccessor.count; i++)
+	// load model on a worker, its images stay encoded until the texture pipeline decodes them.
+	// The cooked copy is mapped as is, it gets cooked on the first run.
+	co_await loader.background();
+	const QString source = ":/Models/Duck.glb";
+	Scene scene;
+	const QString cooked = CookedScene::cachePath(source);
+	const bool loaded = settings_.cooked
+		&& (CookedScene::load(cooked, scene) || (CookedScene::cook(source, cooked) && CookedScene::load(cooked, scene)));
+	SceneLoader sceneLoader;
+	if (!loaded && !sceneLoader.load(source, scene, SceneLayout::BufferViews, SceneImages::Deferred))
+	{
+		co_return;
+	}
+
+	// GL work happens on the render thread, a few chunks per frame.
+	co_await loader.renderThread();
+	buffers_.allocate(*wnd, scene);
+	while (!buffers_.upload(loader.uploadChunk()))
+	{
+		co_await loader.slice();
+	}
+
+	// Each image is decoded once, on the pipeline's workers, however many materials use it.
+	// Mipmapped materials without a sampler of their own get the configured anisotropy,
+	// samplers are shared between equal materials.
+	std::vector<int> imageTextures(scene.images.size(), -1);
+	for (size_t index = 0; index < scene.materials.size(); index++)
+	{
+		const SceneMaterial & material = scene.materials[index];
+		SceneSampler sampler = material.baseColorSampler;
+		const auto custom = settings_.materialSamplers.find(index);
+		if (custom != settings_.materialSamplers.end())
 		{
-			vertices[i * cnt + 3] = normData[i * 3 + 0];
-			vertices[i * cnt + 4] = normData[i * 3 + 1];
-			vertices[i * cnt + 5] = normData[i * 3 + 2];
+			sampler = custom->second;
 		}
-	}
-
-	// tex
-	if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
-	{
-		auto & texAccessor = model.accessors[primitive.attributes.at("TEXCOORD_0")];
-		auto & texView = model.bufferViews[texAccessor.bufferView];
-		auto & texBuffer = model.buffers[texView.buffer];
-		const float * texData = reinterpret_cast<const float *>(
-			texBuffer.data.data() + texView.byteOffset + texAccessor.byteOffset);
-
-		int texOffset = hasNormals ? 6 : 3;
-		for (size_t i = 0; i < texAccessor.count; i++)
+		else if (sampler.minFilter != GL_NEAREST && sampler.minFilter != GL_LINEAR)
 		{
-			vertices[i * cnt + texOffset + 0] = texData[i * 2 + 0];
-			vertices[i * cnt + texOffset + 1] = texData[i * 2 + 1];
+			sampler.anisotropy = settings_.anisotropy;
 		}
-	}
-}
-
-void Duck::loadIndices(const tinygltf::Model & model,
-					  const tinygltf::Primitive & primitive,
-					  std::vector<GLuint> & indices)
-{
-	auto & idxAccessor = model.accessors[primitive.indices];
-	auto & idxView = model.bufferViews[idxAccessor.bufferView];
-	auto & idxBuffer = model.buffers[idxView.buffer];
-
-	const unsigned char * data = idxBuffer.data.data() + idxView.byteOffset + idxAccessor.byteOffset;
+		materialSamplers_.push_back(samplers_.get(*QOpenGLContext::currentContext()->extraFunctions(), sampler));
 
-	indices.clear();
-	indices.reserve(idxAccessor.count);
-
-	if (idxAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-	{
-		const unsigned short * idxData = reinterpret_cast<const unsigned short *>(data);
-		for (size_t i = 0; i < idxAccessor.count; i++)
+		const int image = material.baseColorImage;
+		if (image < 0 || static_cast<size_t>(image) >= scene.images.size())
 		{
-			indices.push_back(idxData[i]);
+			materialTextures_.push_back(-1);
+			continue;
 		}
-	}
-	else if (idxAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-	{
-		const unsigned int * idxData = reinterpret_cast<const unsigned int *>(data);
-		indices.assign(idxData, idxData + idxAccessor.count);
-	}
-	else if (idxAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
-	{
-		const unsigned char * idxData = reinterpret_cast<const unsigned char *>(data);
-		for (size_t i = 0; i < idxAccessor.count; i++)
+		const auto bytes = scene.imageBytes(static_cast<size_t>(image));
+		if (imageTextures[image] < 0 && !bytes.empty())
 		{
-			indices.push_back(idxData[i]);
+			imageTextures[image] = static_cast<int>(textures_.decode(bytes));
 		}
+		materialTextures_.push_back(imageTextures[image]);
 	}
-	else
+
+	// Only the default scene is drawn, alternative scenes are loaded but skipped.
+	for (const auto & draw : scene.draws)
 	{
-		std::cerr << "Unsupported index type: " << idxAccessor.componentType << std::endl;
+		if (draw.scene == scene.defaultScene)
+		{
+			draws_.push_back(draw);
+		}
 	}
 }
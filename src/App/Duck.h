@@ -1,9 +1,24 @@
 #pragma once
 
+#include "AssetLoader.h"
+#include "SamplerCache.h"
+#include "SceneBuffers.h"
+#include "SceneLoader.h"
+#include "TexturePipeline.h"
 #include "Window.h"
 #include <QOpenGLFunctions>
 
-#include <tinygltf/tiny_gltf.h>
+#include <map>
+
+struct DuckSettings
+{
+	// Max anisotropy of materials with a mipmapped min filter, 1 keeps them trilinear.
+	float anisotropy = 8.0f;
+	// Sampler of single materials, by glTF material index, used as is in place of the loaded one.
+	std::map<size_t, SceneSampler> materialSamplers;
+	// Load through a cooked copy in the cache, see CookedScene. Otherwise the glTF is parsed every time.
+	bool cooked = true;
+};
 
 class Duck
 {
@@ -18,25 +33,32 @@ private:
 	GLint spotLightLongitudeUniform_ = -1;
 	GLint enableSpotLightUniform_ = -1;
 
-	QOpenGLBuffer vbo_{QOpenGLBuffer::Type::VertexBuffer};
-	QOpenGLBuffer ibo_{QOpenGLBuffer::Type::IndexBuffer};
-	QOpenGLVertexArrayObject vao_;
+	// Buffers of the whole scene, draws_ select the ranges.
+	SceneBuffers buffers_;
+	std::vector<DrawRecord> draws_;
+
+	// Base color textures, materialTextures_ holds the handle of each material or -1.
+	TexturePipeline textures_;
+	std::vector<int> materialTextures_;
+	std::unique_ptr<QOpenGLTexture> whiteTexture_;
 
-	size_t indexCount_ = 0;
-	size_t vertexCount_ = 0;
+	SamplerCache samplers_;
+	std::vector<GLuint> materialSamplers_;
+
+	DuckSettings settings_;
 
-	std::unique_ptr<QOpenGLTexture> texture_;
 	std::unique_ptr<QOpenGLShaderProgram> program_;
 
-	void loadInterleavedData(const tinygltf::Model & model,
-							 const tinygltf::Primitive & primitive,
-							 GLfloat * vertices, int cnt, bool hasNormals);
-	void loadIndices(const tinygltf::Model & model,
-					 const tinygltf::Primitive & primitive,
-					 std::vector<GLuint> & indices);
+	AssetLoader::Task<void> load(AssetLoader & loader, Window * const wnd);
 
 public:
-	void init(Window * const wnd);
+	explicit Duck(const DuckSettings & settings = {});
+
+	// Compiles the shaders and starts loading the model, which shows up once loaded.
+	void init(Window * const wnd, AssetLoader & loader);
 	void render(Window * const wnd, const QMatrix4x4 & viewProjection);
 	void release();
+
+	// Whether textures are still being decoded or uploaded.
+	[[nodiscard]] bool loading() const;
 };
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "FrameScheduler.h"
+
+#include <utility>
+
+FrameScheduler::FrameScheduler(std::function<void()> redraw)
+	: redraw_{std::move(redraw)}
+{
+}
+
+void FrameScheduler::requestFrame()
+{
+	// Only the first request after a frame posts a redraw, the rest ride along with it.
+	if (dirty_.exchange(true, std::memory_order_acq_rel))
+	{
+		return;
+	}
+	// Queued even on the owning thread, so requests from within a frame schedule the next one.
+	QMetaObject::invokeMethod(&context_, redraw_, Qt::QueuedConnection);
+}
+
+void FrameScheduler::beginFrame()
+{
+	dirty_.store(false, std::memory_order_release);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QObject>
+
+#include <atomic>
+#include <functional>
+
+// Decides when a window draws: only after something marked the frame dirty. Input, UI, running
+// animations and finished background work request frames; with no request pending nothing is drawn
+// and the event loop sleeps.
+class FrameScheduler
+{
+public:
+	// redraw schedules a frame, e.g. QWidget::update(), and is only called on the thread owning the scheduler.
+	explicit FrameScheduler(std::function<void()> redraw);
+
+	FrameScheduler(const FrameScheduler &) = delete;
+	FrameScheduler & operator=(const FrameScheduler &) = delete;
+
+	// Any thread. Requests made before the next frame starts are served by that frame.
+	void requestFrame();
+	// Call when a frame starts drawing, it serves every request made so far.
+	void beginFrame();
+
+private:
+	std::function<void()> redraw_;
+	QObject context_;// queued redraws die with the scheduler
+	std::atomic<bool> dirty_{false};
+};
@@ -0,0 +1,179 @@
+#include "FrameStats.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+float percentile(const std::vector<float> & sorted, const float p)
+{
+	const size_t rank = static_cast<size_t>(std::ceil(p / 100.0f * static_cast<float>(sorted.size())));
+	return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+}// namespace
+
+QJsonObject FrameSummary::toJson() const
+{
+	QJsonObject result;
+	result["frames"] = static_cast<qint64>(frames);
+	result["hitches"] = static_cast<qint64>(hitches);
+	result["mean"] = mean;
+	result["min"] = min;
+	result["p50"] = p50;
+	result["p95"] = p95;
+	result["p99"] = p99;
+	result["max"] = max;
+	return result;
+}
+
+FrameStats::FrameStats(const FrameStatsSettings & settings)
+	: settings_{settings}
+	, mask_{std::bit_ceil(std::max<size_t>(settings.capacity, 1)) - 1}
+	, times_{std::make_unique<std::atomic<float>[]>(mask_ + 1)}
+	, hitches_{std::make_unique<std::atomic<bool>[]>(mask_ + 1)}
+{
+}
+
+void FrameStats::record(const float ms)
+{
+	const uint64_t count = count_.load(std::memory_order_relaxed);
+	const bool hitch = count != 0 && ms > settings_.hitchFactor * average_;
+	average_ = count != 0 ? average_ + settings_.averageWeight * (ms - average_) : ms;
+
+	times_[count & mask_].store(ms, std::memory_order_relaxed);
+	hitches_[count & mask_].store(hitch, std::memory_order_relaxed);
+	if (hitch)
+	{
+		hitchCount_.fetch_add(1, std::memory_order_relaxed);
+	}
+	// Publishes the frame to readers.
+	count_.store(count + 1, std::memory_order_release);
+}
+
+FrameSummary FrameStats::summary(const size_t window) const
+{
+	return summarize(snapshot(window));
+}
+
+FrameSummary FrameStats::summarize(const std::vector<Frame> & frames)
+{
+	FrameSummary result;
+	if (frames.empty())
+	{
+		return result;
+	}
+
+	const auto frameTime = [](const Frame & frame) {
+		return frame.ms;
+	};
+	const auto isHitch = [](const Frame & frame) {
+		return frame.hitch;
+	};
+	std::vector<float> sorted(frames.size());
+	std::transform(frames.begin(), frames.end(), sorted.begin(), frameTime);
+	std::sort(sorted.begin(), sorted.end());
+	result.frames = frames.size();
+	result.hitches = static_cast<size_t>(std::count_if(frames.begin(), frames.end(), isHitch));
+	result.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0f) / static_cast<float>(sorted.size());
+	result.min = sorted.front();
+	result.p50 = percentile(sorted, 50.0f);
+	result.p95 = percentile(sorted, 95.0f);
+	result.p99 = percentile(sorted, 99.0f);
+	result.max = sorted.back();
+	return result;
+}
+
+uint64_t FrameStats::frameCount() const
+{
+	return count_.load(std::memory_order_acquire);
+}
+
+uint64_t FrameStats::hitchCount() const
+{
+	return hitchCount_.load(std::memory_order_relaxed);
+}
+
+QJsonObject FrameStats::toJson(const size_t window) const
+{
+	const std::vector<Frame> frames = snapshot(window);
+	QJsonArray times;
+	QJsonArray hitches;
+	for (const auto & frame : frames)
+	{
+		times.append(frame.ms);
+		if (frame.hitch)
+		{
+			hitches.append(static_cast<qint64>(frame.index));
+		}
+	}
+
+	QJsonObject result;
+	result["summary"] = summarize(frames).toJson();
+	result["totalFrames"] = static_cast<qint64>(frameCount());
+	result["totalHitches"] = static_cast<qint64>(hitchCount());
+	result["firstFrame"] = static_cast<qint64>(frames.empty() ? 0 : frames.front().index);
+	result["frameTimesMs"] = times;
+	result["hitchFrames"] = hitches;
+	return result;
+}
+
+bool FrameStats::save(const QString & path, const size_t window) const
+{
+	return save(path, {{"frame", this}}, window);
+}
+
+bool FrameStats::save(const QString & path, const Series & series, const size_t window)
+{
+	QByteArray bytes;
+	if (path.endsWith(".csv", Qt::CaseInsensitive))
+	{
+		std::ostringstream csv;
+		csv << "series,frame,ms,hitch\n";
+		for (const auto & [name, stats] : series)
+		{
+			for (const auto & frame : stats->snapshot(window))
+			{
+				csv << name.toStdString() << ',' << frame.index << ',' << frame.ms << ',' << (frame.hitch ? 1 : 0) << '\n';
+			}
+		}
+		bytes = QByteArray::fromStdString(csv.str());
+	}
+	else
+	{
+		QJsonObject json;
+		for (const auto & [name, stats] : series)
+		{
+			json[name] = stats->toJson(window);
+		}
+		bytes = QJsonDocument(json).toJson(QJsonDocument::Indented);
+	}
+
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly) || file.write(bytes.constData(), bytes.size()) != bytes.size() || !file.commit())
+	{
+		std::cerr << "Failed to write frame stats: " << path.toStdString() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+auto FrameStats::snapshot(const size_t window) const -> std::vector<Frame>
+{
+	const uint64_t count = count_.load(std::memory_order_acquire);
+	const uint64_t kept = std::min<uint64_t>({count, mask_ + 1, window});
+	std::vector<Frame> frames(kept);
+	for (uint64_t i = 0; i < kept; i++)
+	{
+		const uint64_t index = count - kept + i;
+		frames[i] = {index, times_[index & mask_].load(std::memory_order_relaxed), hitches_[index & mask_].load(std::memory_order_relaxed)};
+	}
+	return frames;
+}
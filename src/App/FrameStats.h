@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct FrameStatsSettings
+{
+	// Frames kept for summaries and exports, rounded up to a power of two.
+	size_t capacity = 4096;
+	// A frame taking this many times the recent average is a hitch.
+	float hitchFactor = 2.0f;
+	// Weight of the newest frame in that average.
+	float averageWeight = 0.1f;
+};
+
+// Frame times of a window of recent frames, in ms. Percentiles are nearest rank.
+struct FrameSummary
+{
+	size_t frames = 0;
+	size_t hitches = 0;
+	float mean = 0.0f;
+	float min = 0.0f;
+	float p50 = 0.0f;
+	float p95 = 0.0f;
+	float p99 = 0.0f;
+	float max = 0.0f;
+
+	[[nodiscard]] QJsonObject toJson() const;
+};
+
+// Per frame times in a lock-free ring buffer. One thread records, any thread may summarize or export;
+// a reader overtaken by the writer sees some newer frames in place of the oldest ones it asked for.
+class FrameStats
+{
+public:
+	explicit FrameStats(const FrameStatsSettings & settings = {});
+
+	void record(float ms);
+
+	// The last `window` frames, at most the capacity.
+	[[nodiscard]] FrameSummary summary(size_t window = SIZE_MAX) const;
+	[[nodiscard]] uint64_t frameCount() const;
+	// Hitches since the start, including frames no longer kept.
+	[[nodiscard]] uint64_t hitchCount() const;
+
+	// Summary and every frame of the window.
+	[[nodiscard]] QJsonObject toJson(size_t window = SIZE_MAX) const;
+	// Named series of frame times, e.g. CPU and GPU times of the same frames.
+	using Series = std::vector<std::pair<QString, const FrameStats *>>;
+
+	// CSV (series,frame,ms,hitch) for a .csv path, JSON with an object per series otherwise.
+	[[nodiscard]] static bool save(const QString & path, const Series & series, size_t window = SIZE_MAX);
+	// A single series named "frame".
+	[[nodiscard]] bool save(const QString & path, size_t window = SIZE_MAX) const;
+
+private:
+	struct Frame
+	{
+		uint64_t index = 0;
+		float ms = 0.0f;
+		bool hitch = false;
+	};
+
+	[[nodiscard]] std::vector<Frame> snapshot(size_t window) const;
+	[[nodiscard]] static FrameSummary summarize(const std::vector<Frame> & frames);
+
+	FrameStatsSettings settings_;
+	size_t mask_ = 0;
+	std::unique_ptr<std::atomic<float>[]> times_;
+	std::unique_ptr<std::atomic<bool>[]> hitches_;
+	std::atomic<uint64_t> count_{0};
+	std::atomic<uint64_t> hitchCount_{0};
+	float average_ = 0.0f;// recording thread only
+};
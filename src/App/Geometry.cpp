@@ -0,0 +1,109 @@
+#include "Geometry.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+#include <cassert>
+#include <cstdint>
+
+VertexLayout & VertexLayout::add(const GLuint location, const GLenum type, const GLint tupleSize, const bool normalized)
+{
+	attributes.push_back({location, type, tupleSize, stride, normalized});
+	stride += static_cast<size_t>(tupleSize) * Geometry::typeSize(type);
+	return *this;
+}
+
+void Geometry::setVertexBytes(const size_t byteSize)
+{
+	assert(layout.stride != 0);
+	assert(byteSize % layout.stride == 0);
+	vertexCount = byteSize / layout.stride;
+}
+
+void Geometry::setIndices(const GLenum type, const size_t count)
+{
+	indexType = type;
+	indexCount = count;
+}
+
+void Geometry::setAttributeBuffers(QOpenGLFunctions & gl) const
+{
+	for (const auto & attribute : layout.attributes)
+	{
+		gl.glEnableVertexAttribArray(attribute.location);
+		gl.glVertexAttribPointer(attribute.location, attribute.tupleSize, attribute.type,
+								 attribute.normalized ? GL_TRUE : GL_FALSE, static_cast<GLsizei>(layout.stride),
+								 reinterpret_cast<const void *>(static_cast<uintptr_t>(attribute.offset)));
+	}
+}
+
+void Geometry::draw(QOpenGLFunctions & gl) const
+{
+#ifndef NDEBUG
+	validate(gl);
+#endif
+
+	if (indexCount != 0)
+	{
+		gl.glDrawElements(primitive, static_cast<GLsizei>(indexCount), indexType, nullptr);
+	}
+	else
+	{
+		gl.glDrawArrays(primitive, 0, static_cast<GLsizei>(vertexCount));
+	}
+}
+
+size_t Geometry::typeSize(const GLenum type)
+{
+	switch (type)
+	{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		default:
+			assert(false && "unsupported vertex component type");
+			return 0;
+	}
+}
+
+void Geometry::validate([[maybe_unused]] QOpenGLFunctions & gl) const
+{
+#ifndef NDEBUG
+	// Every fetched record must lie inside the buffer its attribute points at.
+	// Sizes are read as 64-bit, morph buffers can exceed 2 GB.
+	auto & extra = *QOpenGLContext::currentContext()->extraFunctions();
+	GLint previousBuffer = 0;
+	gl.glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousBuffer);
+	for (const auto & attribute : layout.attributes)
+	{
+		GLint buffer = 0;
+		gl.glGetVertexAttribiv(attribute.location, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+		if (buffer == 0 || vertexCount == 0)
+		{
+			continue;
+		}
+
+		GLint64 bufferSize = 0;
+		gl.glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(buffer));
+		extra.glGetBufferParameteri64v(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &bufferSize);
+		const size_t lastByte = (vertexCount - 1) * layout.stride + attribute.offset
+			+ static_cast<size_t>(attribute.tupleSize) * typeSize(attribute.type);
+		assert(lastByte <= static_cast<size_t>(bufferSize) && "vertex count exceeds the vertex buffer");
+	}
+	gl.glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(previousBuffer));
+
+	if (indexCount != 0)
+	{
+		GLint64 bufferSize = 0;
+		extra.glGetBufferParameteri64v(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &bufferSize);
+		assert(indexCount * typeSize(indexType) <= static_cast<size_t>(bufferSize) && "index count exceeds the index buffer");
+	}
+#endif
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QOpenGLFunctions>
+
+#include <vector>
+
+struct VertexAttribute
+{
+	GLuint location = 0;
+	GLenum type = GL_FLOAT;
+	GLint tupleSize = 0;
+	size_t offset = 0;
+	bool normalized = false;
+};
+
+// Interleaved vertex record: attributes are packed one after another.
+struct VertexLayout
+{
+	std::vector<VertexAttribute> attributes;
+	size_t stride = 0;
+
+	// Appends an attribute right after the previous one.
+	VertexLayout & add(GLuint location, GLenum type, GLint tupleSize, bool normalized = false);
+};
+
+// Everything a draw call needs to know about uploaded geometry.
+// Counts are in vertex records and indices, never in scalar components.
+struct Geometry
+{
+	VertexLayout layout;
+	GLenum primitive = GL_TRIANGLES;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+
+	// Derives the record count from the size of an interleaved buffer.
+	void setVertexBytes(size_t byteSize);
+	void setIndices(GLenum type, size_t count);
+
+	// Points the layout's attributes at the currently bound vertex buffer.
+	void setAttributeBuffers(QOpenGLFunctions & gl) const;
+	// Draws with the VAO already bound. Debug builds check the counts against the bound buffers.
+	void draw(QOpenGLFunctions & gl) const;
+
+	[[nodiscard]] static size_t typeSize(GLenum type);
+
+private:
+	void validate(QOpenGLFunctions & gl) const;
+};
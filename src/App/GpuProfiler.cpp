@@ -0,0 +1,165 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+GpuProfiler::Scope::Scope(GpuProfiler * const profiler, const size_t range)
+	: profiler_{profiler}
+	, range_{range}
+{
+}
+
+GpuProfiler::Scope::~Scope()
+{
+	if (profiler_ != nullptr)
+	{
+		profiler_->end(range_);
+	}
+}
+
+GpuProfiler::GpuProfiler(const GpuProfilerSettings & settings)
+	: settings_{settings}
+{
+}
+
+void GpuProfiler::create()
+{
+	QOpenGLTimerQuery probe;
+	enabled_ = probe.create();
+	probe.destroy();
+	if (!enabled_)
+	{
+		std::cerr << "Timer queries are not supported, GPU profiling is off" << std::endl;
+		return;
+	}
+	frames_.clear();
+	frames_.resize(std::max<size_t>(settings_.framesInFlight, 1));
+	current_ = 0;
+}
+
+void GpuProfiler::destroy()
+{
+	for (auto & frame : frames_)
+	{
+		for (auto & query : frame.queries)
+		{
+			query->destroy();
+		}
+	}
+	frames_.clear();
+	enabled_ = false;
+}
+
+void GpuProfiler::beginFrame()
+{
+	if (!enabled_)
+	{
+		return;
+	}
+
+	current_ = (current_ + 1) % frames_.size();
+	Frame & frame = frames_[current_];
+	if (frame.pending)
+	{
+		collect(frame);
+	}
+	frame.used = 0;
+	frame.ranges.clear();
+	frame.pending = false;
+	frameRange_ = begin(FRAME);
+}
+
+void GpuProfiler::endFrame()
+{
+	if (!enabled_)
+	{
+		return;
+	}
+	end(frameRange_);
+	frames_[current_].pending = true;
+}
+
+auto GpuProfiler::scope(const char * const name) -> Scope
+{
+	return enabled_ ? Scope{this, begin(name)} : Scope{nullptr, 0};
+}
+
+const std::map<std::string, FrameStats> & GpuProfiler::stats() const
+{
+	return stats_;
+}
+
+size_t GpuProfiler::droppedFrames() const
+{
+	return dropped_;
+}
+
+size_t GpuProfiler::begin(const char * const name)
+{
+	auto & ranges = frames_[current_].ranges;
+	const size_t query = timestamp();
+	ranges.push_back({name, query, query});
+	return ranges.size() - 1;
+}
+
+void GpuProfiler::end(const size_t range)
+{
+	auto & ranges = frames_[current_].ranges;
+	if (range < ranges.size())
+	{
+		ranges[range].end = timestamp();
+	}
+}
+
+size_t GpuProfiler::timestamp()
+{
+	Frame & frame = frames_[current_];
+	if (frame.used == frame.queries.size())
+	{
+		auto & query = frame.queries.emplace_back(std::make_unique<QOpenGLTimerQuery>());
+		query->create();
+	}
+	frame.queries[frame.used]->recordTimestamp();
+	return frame.used++;
+}
+
+void GpuProfiler::collect(Frame & frame)
+{
+	if (frame.used == 0 || !frame.queries[frame.used - 1]->isResultAvailable())
+	{
+		dropped_++;
+		return;
+	}
+
+	// Names repeat when a pass is timed more than once per frame, each name gets one sample.
+	std::vector<std::pair<const char *, GLuint64>> totals;
+	for (const auto & range : frame.ranges)
+	{
+		if (range.end == range.begin)
+		{
+			continue;// never ended
+		}
+		const GLuint64 begin = frame.queries[range.begin]->waitForResult();
+		const GLuint64 end = frame.queries[range.end]->waitForResult();
+		const auto sameName = [&range](const auto & total) {
+			return std::strcmp(total.first, range.name) == 0;
+		};
+		const auto total = std::find_if(totals.begin(), totals.end(), sameName);
+		const GLuint64 elapsed = end > begin ? end - begin : 0;
+		if (total != totals.end())
+		{
+			total->second += elapsed;
+		}
+		else
+		{
+			totals.emplace_back(range.name, elapsed);
+		}
+	}
+
+	for (const auto & [name, nanoseconds] : totals)
+	{
+		stats_.try_emplace(name, settings_.stats).first->second.record(static_cast<float>(nanoseconds) / 1.0e6f);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "FrameStats.h"
+
+#include <QOpenGLTimerQuery>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct GpuProfilerSettings
+{
+	// Frames between issuing a frame's queries and reading them back. Results not ready by then are
+	// dropped rather than waited for.
+	size_t framesInFlight = 4;
+	FrameStatsSettings stats;
+};
+
+// GPU time of passes from GL_TIMESTAMP queries (ARB_timer_query, core since GL 3.3, llvmpipe has it).
+// Unlike GL_TIME_ELAPSED queries timestamps nest, so scopes can too. Every frame uses its own set of
+// queries and is read back framesInFlight frames later, the profiler never stalls the pipeline.
+class GpuProfiler
+{
+public:
+	// Times the commands issued during its lifetime.
+	class Scope
+	{
+	public:
+		~Scope();
+
+		Scope(const Scope &) = delete;
+		Scope & operator=(const Scope &) = delete;
+
+	private:
+		friend class GpuProfiler;
+		Scope(GpuProfiler * profiler, size_t range);
+
+		GpuProfiler * profiler_;
+		size_t range_;
+	};
+
+	// Name of the series timing whole frames.
+	static constexpr const char * FRAME = "frame";
+
+	explicit GpuProfiler(const GpuProfilerSettings & settings = {});
+
+	// Need the GL context. Without timer queries the profiler stays off and records nothing.
+	void create();
+	void destroy();
+
+	// Collects the oldest frame in flight and starts timing a new one.
+	void beginFrame();
+	void endFrame();
+	// Scopes of the same name within a frame add up. The name must outlive the frame's read back.
+	[[nodiscard]] Scope scope(const char * name);
+
+	// Milliseconds per frame of each scope name, on the render thread.
+	[[nodiscard]] const std::map<std::string, FrameStats> & stats() const;
+	// Frames whose results were not ready in time.
+	[[nodiscard]] size_t droppedFrames() const;
+
+private:
+	struct Range
+	{
+		const char * name = nullptr;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	struct Frame
+	{
+		std::vector<std::unique_ptr<QOpenGLTimerQuery>> queries;// reused, grown on demand
+		size_t used = 0;
+		std::vector<Range> ranges;
+		bool pending = false;
+	};
+
+	size_t begin(const char * name);
+	void end(size_t range);
+	size_t timestamp();
+	void collect(Frame & frame);
+
+	GpuProfilerSettings settings_;
+	bool enabled_ = false;
+	std::vector<Frame> frames_;
+	size_t current_ = 0;
+	size_t frameRange_ = 0;
+	size_t dropped_ = 0;
+	std::map<std::string, FrameStats> stats_;
+};
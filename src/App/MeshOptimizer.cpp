@@ -0,0 +1,367 @@
+#include "MeshOptimizer.h"
+
+#include <QVector3D>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+constexpr size_t NONE = SIZE_MAX;
+
+// Triangles around each vertex, offsets[v] to offsets[v + 1] in triangles.
+struct Adjacency
+{
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+};
+
+Adjacency adjacency(const std::span<const uint32_t> indices, const size_t vertexCount)
+{
+	Adjacency result;
+	result.offsets.assign(vertexCount + 1, 0);
+	for (const uint32_t index : indices)
+	{
+		result.offsets[index + 1]++;
+	}
+	std::partial_sum(result.offsets.begin(), result.offsets.end(), result.offsets.begin());
+
+	std::vector<uint32_t> fill(result.offsets.begin(), result.offsets.end() - 1);
+	result.triangles.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		result.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+	return result;
+}
+
+// FIFO post-transform cache: a vertex is cached while fewer than `size` misses happened since its own.
+class FifoCache
+{
+public:
+	FifoCache(const size_t vertexCount, const size_t size)
+		: stamps_(vertexCount, 0)
+		, time_{size + 1}
+		, size_{size}
+	{
+	}
+
+	// Returns whether the vertex had to be shaded.
+	bool touch(const uint32_t vertex)
+	{
+		if (time_ - stamps_[vertex] > size_)
+		{
+			stamps_[vertex] = time_++;
+			return true;
+		}
+		return false;
+	}
+
+	size_t touch(const std::span<const uint32_t> indices, const size_t triangle)
+	{
+		return touch(indices[3 * triangle]) + touch(indices[3 * triangle + 1]) + touch(indices[3 * triangle + 2]);
+	}
+
+	void flush()
+	{
+		time_ += size_ + 1;
+	}
+
+private:
+	std::vector<size_t> stamps_;
+	size_t time_;
+	size_t size_;
+};
+
+// Tipsify's triangle order. clusters receives where the order had to jump to a vertex that is
+// likely out of cache, the first cluster starts at 0.
+std::vector<uint32_t> tipsify(const std::span<const uint32_t> indices, const size_t vertexCount, const size_t cacheSize,
+							  std::vector<size_t> & clusters)
+{
+	const Adjacency adjacent = adjacency(indices, vertexCount);
+	std::vector<uint32_t> live(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		live[v] = adjacent.offsets[v + 1] - adjacent.offsets[v];
+	}
+
+	std::vector<size_t> stamps(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	std::vector<bool> emitted(indices.size() / 3, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> order;
+	order.reserve(indices.size() / 3);
+	size_t cursor = 0;
+
+	const auto skipDeadEnd = [&]() -> size_t {
+		while (!deadEnd.empty())
+		{
+			const uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[vertex] != 0)
+			{
+				return vertex;
+			}
+		}
+		for (; cursor < vertexCount; cursor++)
+		{
+			if (live[cursor] != 0)
+			{
+				return cursor;
+			}
+		}
+		return NONE;
+	};
+
+	clusters.assign(1, 0);
+	size_t fanning = vertexCount != 0 ? 0 : NONE;
+	while (fanning != NONE)
+	{
+		// Emit every remaining triangle around the fanning vertex.
+		candidates.clear();
+		for (uint32_t i = adjacent.offsets[fanning]; i < adjacent.offsets[fanning + 1]; i++)
+		{
+			const uint32_t triangle = adjacent.triangles[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = true;
+			order.push_back(triangle);
+			for (size_t k = 0; k < 3; k++)
+			{
+				const uint32_t vertex = indices[3 * triangle + k];
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				if (time - stamps[vertex] > cacheSize)
+				{
+					stamps[vertex] = time++;
+				}
+			}
+		}
+
+		// Next, the oldest candidate that stays in cache while its remaining triangles are emitted.
+		size_t next = NONE;
+		size_t bestPriority = 0;
+		for (const uint32_t vertex : candidates)
+		{
+			if (live[vertex] == 0)
+			{
+				continue;
+			}
+			const size_t age = time - stamps[vertex];
+			const size_t priority = age + 2 * live[vertex] <= cacheSize ? age : 0;
+			if (next == NONE || priority > bestPriority)
+			{
+				next = vertex;
+				bestPriority = priority;
+			}
+		}
+		if (next == NONE)
+		{
+			next = skipDeadEnd();
+			if (next != NONE && order.size() > clusters.back())
+			{
+				clusters.push_back(order.size());
+			}
+		}
+		fanning = next;
+	}
+	return order;
+}
+}// namespace
+
+float VertexCacheStats::acmr() const
+{
+	return triangles != 0 ? static_cast<float>(misses) / static_cast<float>(triangles) : 0.0f;
+}
+
+float VertexCacheStats::atvr() const
+{
+	return vertices != 0 ? static_cast<float>(misses) / static_cast<float>(vertices) : 0.0f;
+}
+
+VertexCacheStats & VertexCacheStats::operator+=(const VertexCacheStats & other)
+{
+	triangles += other.triangles;
+	vertices += other.vertices;
+	misses += other.misses;
+	return *this;
+}
+
+MeshOptimizer::MeshOptimizer(const MeshOptimizerSettings & settings)
+	: settings_{settings}
+{
+}
+
+bool MeshOptimizer::optimize(const std::span<uint32_t> indices, const std::span<float> vertices, const size_t stride) const
+{
+	const size_t vertexCount = stride != 0 ? vertices.size() / stride : 0;
+	const size_t triangleCount = indices.size() / 3;
+	const auto outOfRange = [vertexCount](const uint32_t index) {
+		return index >= vertexCount;
+	};
+	if (stride < 3 || indices.size() % 3 != 0 || std::any_of(indices.begin(), indices.end(), outOfRange))
+	{
+		return false;
+	}
+
+	std::vector<size_t> clusters;
+	const std::vector<uint32_t> order = tipsify(indices, vertexCount, settings_.cacheSize, clusters);
+	std::vector<uint32_t> tipsified(indices.size());
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		std::copy_n(indices.begin() + 3 * order[i], 3, tipsified.begin() + 3 * i);
+	}
+
+	// Split the clusters further wherever the triangles so far already reach the cluster's ACMR
+	// within the threshold, smaller clusters sort better.
+	std::vector<size_t> splits;
+	clusters.push_back(triangleCount);
+	FifoCache cache(vertexCount, settings_.cacheSize);
+	for (size_t c = 0; c + 1 < clusters.size(); c++)
+	{
+		const size_t begin = clusters[c];
+		const size_t end = clusters[c + 1];
+		size_t misses = 0;
+		cache.flush();
+		for (size_t i = begin; i < end; i++)
+		{
+			misses += cache.touch(tipsified, i);
+		}
+		const float threshold = settings_.overdrawThreshold * static_cast<float>(misses) / static_cast<float>(end - begin);
+
+		splits.push_back(begin);
+		size_t start = begin;
+		misses = 0;
+		cache.flush();
+		for (size_t i = begin; i + 1 < end; i++)
+		{
+			misses += cache.touch(tipsified, i);
+			if (static_cast<float>(misses) <= threshold * static_cast<float>(i + 1 - start))
+			{
+				splits.push_back(i + 1);
+				start = i + 1;
+				misses = 0;
+				cache.flush();
+			}
+		}
+	}
+	splits.push_back(triangleCount);
+
+	// Clusters facing away from the mesh's center, the outside of roughly convex parts, draw first
+	// and occlude what follows.
+	const auto position = [&](const uint32_t vertex) {
+		const float * const p = vertices.data() + vertex * stride;
+		return QVector3D(p[0], p[1], p[2]);
+	};
+	const auto triangleArea = [&](const size_t triangle, QVector3D & centroid) {
+		const QVector3D a = position(tipsified[3 * triangle]);
+		const QVector3D b = position(tipsified[3 * triangle + 1]);
+		const QVector3D c = position(tipsified[3 * triangle + 2]);
+		centroid = (a + b + c) / 3.0f;
+		return QVector3D::crossProduct(b - a, c - a);
+	};
+
+	QVector3D meshCenter;
+	float meshArea = 0.0f;
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		QVector3D centroid;
+		const float area = triangleArea(i, centroid).length();
+		meshCenter += centroid * area;
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCenter /= meshArea;
+	}
+
+	const size_t clusterCount = splits.size() - 1;
+	std::vector<float> keys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		QVector3D center;
+		QVector3D normal;
+		float area = 0.0f;
+		for (size_t i = splits[c]; i < splits[c + 1]; i++)
+		{
+			QVector3D centroid;
+			const QVector3D cross = triangleArea(i, centroid);
+			center += centroid * cross.length();
+			normal += cross;
+			area += cross.length();
+		}
+		if (area > 0.0f)
+		{
+			center /= area;
+		}
+		keys[c] = QVector3D::dotProduct(center - meshCenter, normal.normalized());
+	}
+	std::vector<size_t> sorted(clusterCount);
+	std::iota(sorted.begin(), sorted.end(), 0);
+	const auto outward = [&keys](const size_t a, const size_t b) {
+		return keys[a] > keys[b];
+	};
+	std::stable_sort(sorted.begin(), sorted.end(), outward);
+
+	size_t written = 0;
+	for (const size_t c : sorted)
+	{
+		const size_t count = 3 * (splits[c + 1] - splits[c]);
+		std::copy_n(tipsified.begin() + 3 * splits[c], count, indices.begin() + written);
+		written += count;
+	}
+
+	// Vertices in the order the indices first use them, unused ones last.
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t next = 0;
+	for (uint32_t & index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+	for (auto & target : remap)
+	{
+		if (target == UINT32_MAX)
+		{
+			target = next++;
+		}
+	}
+
+	const std::vector<float> original(vertices.begin(), vertices.end());
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		std::copy_n(original.begin() + v * stride, stride, vertices.begin() + remap[v] * stride);
+	}
+	return true;
+}
+
+VertexCacheStats MeshOptimizer::analyze(const std::span<const uint32_t> indices, const size_t vertexCount) const
+{
+	VertexCacheStats stats;
+	stats.triangles = indices.size() / 3;
+
+	FifoCache cache(vertexCount, settings_.cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	for (const uint32_t index : indices)
+	{
+		if (index >= vertexCount)
+		{
+			continue;
+		}
+		stats.misses += cache.touch(index);
+		if (!used[index])
+		{
+			used[index] = true;
+			stats.vertices++;
+		}
+	}
+	return stats;
+}
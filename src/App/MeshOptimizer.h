@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+struct MeshOptimizerSettings
+{
+	// Entries of the FIFO post-transform cache that Tipsify targets and the statistics simulate.
+	size_t cacheSize = 16;
+	// Clusters may cost this much more ACMR than the plain Tipsify order, in exchange for less overdraw.
+	// 1 keeps the clusters Tipsify's cache flushes produce.
+	float overdrawThreshold = 1.05f;
+};
+
+// Post-transform cache behaviour of an index buffer, simulated with a FIFO cache.
+struct VertexCacheStats
+{
+	size_t triangles = 0;
+	size_t vertices = 0;// distinct vertices referenced
+	size_t misses = 0;// vertex shader invocations
+
+	// Average cache miss ratio: shaded vertices per triangle, 0.5 at best for large meshes, 3 at worst.
+	[[nodiscard]] float acmr() const;
+	// Average transformed vertex ratio: shaded vertices per vertex, 1 at best.
+	[[nodiscard]] float atvr() const;
+
+	VertexCacheStats & operator+=(const VertexCacheStats & other);
+};
+
+// Reorders indexed triangle lists after loading:
+// triangles for the post-transform cache (Tipsify, Sander et al. 2007), clusters of them front to back
+// to reduce overdraw, and vertices in the order the indices first use them for fetch locality.
+class MeshOptimizer
+{
+public:
+	explicit MeshOptimizer(const MeshOptimizerSettings & settings = {});
+
+	// Reorders the triangles of `indices` and the records of `vertices` in place, remapping the indices.
+	// Vertices are records of `stride` floats starting with the position.
+	// Fails, changing nothing, if an index is out of range.
+	[[nodiscard]] bool optimize(std::span<uint32_t> indices, std::span<float> vertices, size_t stride) const;
+
+	[[nodiscard]] VertexCacheStats analyze(std::span<const uint32_t> indices, size_t vertexCount) const;
+
+private:
+	MeshOptimizerSettings settings_;
+};
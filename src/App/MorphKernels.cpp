@@ -0,0 +1,364 @@
+#include "MorphKernels.h"
+#include "MorphMeshGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MORPH_KERNELS_SSE2 1
+#define MORPH_KERNELS_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MORPH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MORPH_TARGET_AVX2
+#endif
+
+namespace
+{
+constexpr float PI = 3.14159265358979323846f;
+
+// Sphere is scaled so that it passes through the cube corners.
+const float SPHERE_SCALE = std::sqrt(3.0f);
+
+// One lane of a ring: sin/cos of theta and, for caps, the cube projection factor
+// t = tan(phi) * side * k, k = sqrt(x1^2 + z1^2) / max(|x1|, |z1|) = 1 / max(|cos|, |sin|).
+inline void writeSphere(MorphVertex & v, const float sinPhi, const float cosPhi, const float c, const float s)
+{
+	v.pos1[0] = v.norm1[0] = sinPhi * c * SPHERE_SCALE;
+	v.pos1[1] = v.norm1[1] = cosPhi * SPHERE_SCALE;
+	v.pos1[2] = v.norm1[2] = sinPhi * s * SPHERE_SCALE;
+}
+
+inline void writeCubeCap(MorphVertex & v, const float side, const float c, const float s, const float t)
+{
+	v.pos2[0] = t * c;
+	v.pos2[1] = side;
+	v.pos2[2] = t * s;
+	v.norm2[0] = 0;
+	v.norm2[1] = side;
+	v.norm2[2] = 0;
+}
+
+float thetaStep(const size_t count)
+{
+	return 2.0f * PI / static_cast<float>(count);
+}
+
+void capRingScalarFrom(const float phi, const float side, const size_t count, size_t j, MorphVertex * const out)
+{
+	const float sinPhi = std::sin(phi);
+	const float cosPhi = std::cos(phi);
+	const float tanSide = std::tan(phi) * side;
+	const float step = thetaStep(count);
+
+	for (; j < count; j++)
+	{
+		const float theta = (static_cast<float>(j) + 0.5f) * step;
+		const float c = std::cos(theta);
+		const float s = std::sin(theta);
+		writeSphere(out[j], sinPhi, cosPhi, c, s);
+		writeCubeCap(out[j], side, c, s, tanSide / std::max(std::abs(c), std::abs(s)));
+	}
+}
+
+void sphereRingScalarFrom(const float phi, const size_t count, size_t j, MorphVertex * const out)
+{
+	const float sinPhi = std::sin(phi);
+	const float cosPhi = std::cos(phi);
+	const float step = thetaStep(count);
+
+	for (; j < count; j++)
+	{
+		const float theta = (static_cast<float>(j) + 0.5f) * step;
+		writeSphere(out[j], sinPhi, cosPhi, std::cos(theta), std::sin(theta));
+	}
+}
+
+void capRingScalar(const float phi, const float side, const size_t count, MorphVertex * const out)
+{
+	capRingScalarFrom(phi, side, count, 0, out);
+}
+
+void sphereRingScalar(const float phi, const size_t count, MorphVertex * const out)
+{
+	sphereRingScalarFrom(phi, count, 0, out);
+}
+
+#ifdef MORPH_KERNELS_SSE2
+// Cephes sinf/cosf: reduction to [-PI/4, PI/4] by octant and two minimax polynomials.
+// Accurate to a few ulp for |x| < 8192, which covers theta in [0, 2 PI).
+constexpr float FOPI = 1.27323954473516f;// 4 / PI
+constexpr float DP1 = 0.78515625f;
+constexpr float DP2 = 2.4187564849853515625e-4f;
+constexpr float DP3 = 3.77489497744594108e-8f;
+constexpr float SIN_P0 = -1.9515295891e-4f;
+constexpr float SIN_P1 = 8.3321608736e-3f;
+constexpr float SIN_P2 = -1.6666654611e-1f;
+constexpr float COS_P0 = 2.443315711809948e-5f;
+constexpr float COS_P1 = -1.388731625493765e-3f;
+constexpr float COS_P2 = 4.166664568298827e-2f;
+
+inline void sincos4(__m128 x, __m128 & sinOut, __m128 & cosOut)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 sinSign = _mm_and_ps(x, signMask);
+	x = _mm_andnot_ps(signMask, x);
+
+	__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOPI)));
+	octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+	const __m128 y = _mm_cvtepi32_ps(octant);
+
+	const __m128i four = _mm_set1_epi32(4);
+	const __m128 swapSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, four), 29));
+	const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), four), 29));
+	const __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+	sinSign = _mm_xor_ps(sinSign, swapSin);
+
+	x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+	x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+	x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+	const __m128 z = _mm_mul_ps(x, x);
+
+	__m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1));
+	cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(COS_P2));
+	cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+	cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+	__m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1));
+	sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(SIN_P2));
+	sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+	const __m128 s = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+	const __m128 c = _mm_or_ps(_mm_and_ps(polyMask, cosPoly), _mm_andnot_ps(polyMask, sinPoly));
+	sinOut = _mm_xor_ps(s, sinSign);
+	cosOut = _mm_xor_ps(c, cosSign);
+}
+
+void capRingSse2(const float phi, const float side, const size_t count, MorphVertex * const out)
+{
+	const float sinPhi = std::sin(phi);
+	const float cosPhi = std::cos(phi);
+	const __m128 tanSide = _mm_set1_ps(std::tan(phi) * side);
+	const __m128 step = _mm_set1_ps(thetaStep(count));
+	const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	alignas(16) float c[4], s[4], t[4];
+	size_t j = 0;
+	for (; j + 4 <= count; j += 4)
+	{
+		const __m128 theta = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(j)), lanes), step);
+		__m128 vs, vc;
+		sincos4(theta, vs, vc);
+		const __m128 maxAbs = _mm_max_ps(_mm_andnot_ps(signMask, vc), _mm_andnot_ps(signMask, vs));
+		_mm_store_ps(c, vc);
+		_mm_store_ps(s, vs);
+		_mm_store_ps(t, _mm_div_ps(tanSide, maxAbs));
+
+		for (size_t l = 0; l < 4; l++)
+		{
+			writeSphere(out[j + l], sinPhi, cosPhi, c[l], s[l]);
+			writeCubeCap(out[j + l], side, c[l], s[l], t[l]);
+		}
+	}
+	capRingScalarFrom(phi, side, count, j, out);
+}
+
+void sphereRingSse2(const float phi, const size_t count, MorphVertex * const out)
+{
+	const float sinPhi = std::sin(phi);
+	const float cosPhi = std::cos(phi);
+	const __m128 step = _mm_set1_ps(thetaStep(count));
+	const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+	alignas(16) float c[4], s[4];
+	size_t j = 0;
+	for (; j + 4 <= count; j += 4)
+	{
+		const __m128 theta = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(j)), lanes), step);
+		__m128 vs, vc;
+		sincos4(theta, vs, vc);
+		_mm_store_ps(c, vc);
+		_mm_store_ps(s, vs);
+
+		for (size_t l = 0; l < 4; l++)
+		{
+			writeSphere(out[j + l], sinPhi, cosPhi, c[l], s[l]);
+		}
+	}
+	sphereRingScalarFrom(phi, count, j, out);
+}
+#endif
+
+#ifdef MORPH_KERNELS_AVX2
+MORPH_TARGET_AVX2 inline void sincos8(__m256 x, __m256 & sinOut, __m256 & cosOut)
+{
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	__m256 sinSign = _mm256_and_ps(x, signMask);
+	x = _mm256_andnot_ps(signMask, x);
+
+	__m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FOPI)));
+	octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+	const __m256 y = _mm256_cvtepi32_ps(octant);
+
+	const __m256i four = _mm256_set1_epi32(4);
+	const __m256 swapSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, four), 29));
+	const __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), four), 29));
+	const __m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+	sinSign = _mm256_xor_ps(sinSign, swapSin);
+
+	x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP1)));
+	x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP2)));
+	x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP3)));
+	const __m256 z = _mm256_mul_ps(x, x);
+
+	__m256 cosPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_P0), z), _mm256_set1_ps(COS_P1));
+	cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, z), _mm256_set1_ps(COS_P2));
+	cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+	cosPoly = _mm256_add_ps(_mm256_sub_ps(cosPoly, _mm256_mul_ps(z, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+
+	__m256 sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_P0), z), _mm256_set1_ps(SIN_P1));
+	sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, z), _mm256_set1_ps(SIN_P2));
+	sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sinPoly, z), x), x);
+
+	const __m256 s = _mm256_blendv_ps(cosPoly, sinPoly, polyMask);
+	const __m256 c = _mm256_blendv_ps(sinPoly, cosPoly, polyMask);
+	sinOut = _mm256_xor_ps(s, sinSign);
+	cosOut = _mm256_xor_ps(c, cosSign);
+}
+
+MORPH_TARGET_AVX2 void capRingAvx2(const float phi, const float side, const size_t count, MorphVertex * const out)
+{
+	const float sinPhi = std::sin(phi);
+	const float cosPhi = std::cos(phi);
+	const __m256 tanSide = _mm256_set1_ps(std::tan(phi) * side);
+	const __m256 step = _mm256_set1_ps(thetaStep(count));
+	const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+	alignas(32) float c[8], s[8], t[8];
+	size_t j = 0;
+	for (; j + 8 <= count; j += 8)
+	{
+		const __m256 theta = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(j)), lanes), step);
+		__m256 vs, vc;
+		sincos8(theta, vs, vc);
+		const __m256 maxAbs = _mm256_max_ps(_mm256_andnot_ps(signMask, vc), _mm256_andnot_ps(signMask, vs));
+		_mm256_store_ps(c, vc);
+		_mm256_store_ps(s, vs);
+		_mm256_store_ps(t, _mm256_div_ps(tanSide, maxAbs));
+
+		for (size_t l = 0; l < 8; l++)
+		{
+			writeSphere(out[j + l], sinPhi, cosPhi, c[l], s[l]);
+			writeCubeCap(out[j + l], side, c[l], s[l], t[l]);
+		}
+	}
+	capRingScalarFrom(phi, side, count, j, out);
+}
+
+MORPH_TARGET_AVX2 void sphereRingAvx2(const float phi, const size_t count, MorphVertex * const out)
+{
+	const float sinPhi = std::sin(phi);
+	const float cosPhi = std::cos(phi);
+	const __m256 step = _mm256_set1_ps(thetaStep(count));
+	const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+
+	alignas(32) float c[8], s[8];
+	size_t j = 0;
+	for (; j + 8 <= count; j += 8)
+	{
+		const __m256 theta = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(j)), lanes), step);
+		__m256 vs, vc;
+		sincos8(theta, vs, vc);
+		_mm256_store_ps(c, vc);
+		_mm256_store_ps(s, vs);
+
+		for (size_t l = 0; l < 8; l++)
+		{
+			writeSphere(out[j + l], sinPhi, cosPhi, c[l], s[l]);
+		}
+	}
+	sphereRingScalarFrom(phi, count, j, out);
+}
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+const MorphKernels SCALAR_KERNELS{"scalar", capRingScalar, sphereRingScalar};
+#ifdef MORPH_KERNELS_SSE2
+const MorphKernels SSE2_KERNELS{"sse2", capRingSse2, sphereRingSse2};
+#endif
+#ifdef MORPH_KERNELS_AVX2
+const MorphKernels AVX2_KERNELS{"avx2", capRingAvx2, sphereRingAvx2};
+#endif
+
+const MorphKernels & selectKernels()
+{
+#ifdef MORPH_KERNELS_AVX2
+	if (cpuHasAvx2())
+	{
+		return AVX2_KERNELS;
+	}
+#endif
+#ifdef MORPH_KERNELS_SSE2
+	return SSE2_KERNELS;
+#else
+	return SCALAR_KERNELS;
+#endif
+}
+
+}// namespace
+
+const MorphKernels & MorphKernels::scalar()
+{
+	return SCALAR_KERNELS;
+}
+
+const MorphKernels & MorphKernels::best()
+{
+	static const MorphKernels & selected = selectKernels();
+	return selected;
+}
+
+std::vector<const MorphKernels *> MorphKernels::supported()
+{
+	std::vector<const MorphKernels *> kernels{&SCALAR_KERNELS};
+#ifdef MORPH_KERNELS_SSE2
+	kernels.push_back(&SSE2_KERNELS);
+#endif
+#ifdef MORPH_KERNELS_AVX2
+	if (cpuHasAvx2())
+	{
+		kernels.push_back(&AVX2_KERNELS);
+	}
+#endif
+	return kernels;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct MorphVertex;
+
+// Per-ring evaluation of the morph endpoints, theta_j = 2 * PI * (j + 0.5) / count.
+struct MorphKernels
+{
+	const char * name;
+
+	// Sphere endpoint plus its central projection onto the cube face y = side.
+	void (*capRing)(float phi, float side, size_t count, MorphVertex * out);
+	// Sphere endpoint only, cube body points are filled by the caller.
+	void (*sphereRing)(float phi, size_t count, MorphVertex * out);
+
+	// Reference implementation with libm sin/cos.
+	static const MorphKernels & scalar();
+	// Widest SIMD variant supported by the running CPU, picked once.
+	static const MorphKernels & best();
+	// Every variant compiled in that the running CPU supports, scalar first.
+	static std::vector<const MorphKernels *> supported();
+
+	// Largest deviation of a SIMD variant from scalar(), relative to max(1, |scalar value|).
+	static constexpr float TOLERANCE = 1.0e-5f;
+};
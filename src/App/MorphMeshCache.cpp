@@ -0,0 +1,175 @@
+#include "MorphMeshCache.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+// Followed by the vertex bytes at DATA_OFFSET, then the index bytes at the next 16 byte boundary.
+struct MorphMeshCache::Header
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t resolution;
+	uint32_t source;
+	uint32_t format;
+	uint32_t shapeCount;
+	uint8_t shapes[MorphTargets::MAX_TARGETS];
+	uint64_t vertexBytes;
+	uint64_t indexBytes;
+};
+
+namespace
+{
+constexpr size_t DATA_OFFSET = 64;
+constexpr size_t DATA_ALIGNMENT = 16;
+
+constexpr size_t alignUp(const size_t value, const size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+}// namespace
+
+MorphMeshCache::MorphMeshCache(Key key, const QString & directory)
+	: key_{std::move(key)}
+{
+	static_assert(sizeof(Header) <= DATA_OFFSET);
+	assert(key_.shapes.size() <= MorphTargets::MAX_TARGETS);
+
+	QString shapes;
+	for (const auto shape : key_.shapes)
+	{
+		shapes += QString::number(static_cast<int>(shape));
+	}
+
+	const QString root = directory.isEmpty() ? QStandardPaths::writableLocation(QStandardPaths::CacheLocation) : directory;
+	path_ = QDir(root).filePath(QString("morph-v%1-n%2-s%3-f%4-%5.mesh")
+									.arg(VERSION)
+									.arg(key_.resolution)
+									.arg(key_.source)
+									.arg(key_.format)
+									.arg(shapes.isEmpty() ? QString("none") : shapes));
+}
+
+MorphMeshCache::~MorphMeshCache()
+{
+	unmap();
+}
+
+bool MorphMeshCache::load(const size_t vertexBytes, const size_t indexBytes)
+{
+	file_.setFileName(path_);
+	if (!file_.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	if (static_cast<size_t>(file_.size()) != fileSize(vertexBytes, indexBytes) || !map(vertexBytes, indexBytes))
+	{
+		file_.close();
+		return false;
+	}
+
+	const Header expected = header(vertexBytes, indexBytes);
+	if (std::memcmp(mapped_, &expected, sizeof(Header)) != 0)
+	{
+		std::cerr << "Ignoring stale morph mesh cache: " << path_.toStdString() << std::endl;
+		unmap();
+		return false;
+	}
+	return true;
+}
+
+bool MorphMeshCache::create(const size_t vertexBytes, const size_t indexBytes)
+{
+	if (!QDir().mkpath(QFileInfo(path_).absolutePath()))
+	{
+		return false;
+	}
+
+	// Concurrent instances must not write into the same file.
+	file_.setFileName(path_ + QString(".%1.tmp").arg(QCoreApplication::applicationPid()));
+	const auto size = static_cast<qint64>(fileSize(vertexBytes, indexBytes));
+	if (!file_.open(QIODevice::ReadWrite | QIODevice::Truncate) || !file_.resize(size) || !map(vertexBytes, indexBytes))
+	{
+		std::cerr << "Failed to create morph mesh cache: " << path_.toStdString() << std::endl;
+		file_.close();
+		file_.remove();
+		return false;
+	}
+
+	// The header goes in last, so an interrupted write never looks valid.
+	std::memset(mapped_, 0, DATA_OFFSET);
+	return true;
+}
+
+bool MorphMeshCache::commit()
+{
+	assert(mapped_ != nullptr);
+
+	const Header complete = header(vertexBytes_, indexBytes_);
+	std::memcpy(mapped_, &complete, sizeof(Header));
+	unmap();
+
+	QFile::remove(path_);
+	if (!file_.rename(path_))
+	{
+		std::cerr << "Failed to store morph mesh cache: " << path_.toStdString() << std::endl;
+		file_.remove();
+		return false;
+	}
+	return true;
+}
+
+MorphMeshCache::Header MorphMeshCache::header(const size_t vertexBytes, const size_t indexBytes) const
+{
+	Header header{};
+	std::memcpy(header.magic, "MRPH", sizeof(header.magic));
+	header.version = VERSION;
+	header.resolution = key_.resolution;
+	header.source = key_.source;
+	header.format = key_.format;
+	header.shapeCount = static_cast<uint32_t>(key_.shapes.size());
+	for (size_t i = 0; i < key_.shapes.size(); i++)
+	{
+		header.shapes[i] = static_cast<uint8_t>(key_.shapes[i]);
+	}
+	header.vertexBytes = vertexBytes;
+	header.indexBytes = indexBytes;
+	return header;
+}
+
+size_t MorphMeshCache::fileSize(const size_t vertexBytes, const size_t indexBytes)
+{
+	return DATA_OFFSET + alignUp(vertexBytes, DATA_ALIGNMENT) + indexBytes;
+}
+
+bool MorphMeshCache::map(const size_t vertexBytes, const size_t indexBytes)
+{
+	mapped_ = file_.map(0, static_cast<qint64>(fileSize(vertexBytes, indexBytes)));
+	if (mapped_ == nullptr)
+	{
+		return false;
+	}
+
+	vertexBytes_ = vertexBytes;
+	indexBytes_ = indexBytes;
+	vertices_ = reinterpret_cast<std::byte *>(mapped_) + DATA_OFFSET;
+	indices_ = vertices_ + alignUp(vertexBytes, DATA_ALIGNMENT);
+	return true;
+}
+
+void MorphMeshCache::unmap()
+{
+	if (mapped_ != nullptr)
+	{
+		file_.unmap(mapped_);
+		mapped_ = nullptr;
+		vertices_ = indices_ = nullptr;
+	}
+	file_.close();
+}
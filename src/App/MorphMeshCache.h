@@ -0,0 +1,65 @@
+#pragma once
+
+#include "MorphTargets.h"
+
+#include <QFile>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Versioned file with the vertex and index bytes of one generated morph mesh.
+// Hits are memory-mapped so the data goes to the GPU without being generated or copied first.
+class MorphMeshCache
+{
+public:
+	// Bump whenever the generated records or the file layout change.
+	static constexpr uint32_t VERSION = 1;
+
+	// Everything the generated bytes depend on.
+	struct Key
+	{
+		uint32_t resolution = 0;
+		uint32_t source = 0;
+		uint32_t format = 0;
+		std::vector<MorphShape> shapes;
+	};
+
+	// Cache files live in QStandardPaths::CacheLocation when directory is empty.
+	explicit MorphMeshCache(Key key, const QString & directory = {});
+	~MorphMeshCache();
+
+	MorphMeshCache(const MorphMeshCache &) = delete;
+	MorphMeshCache & operator=(const MorphMeshCache &) = delete;
+
+	// Maps an existing file read-only. Fails on a missing, stale or truncated file.
+	[[nodiscard]] bool load(size_t vertexBytes, size_t indexBytes);
+	// Creates a temporary file of the given sizes and maps it for writing.
+	[[nodiscard]] bool create(size_t vertexBytes, size_t indexBytes);
+	// Finishes a created file and moves it into place. Unmaps it, the views are invalid afterwards.
+	bool commit();
+
+	// Views into the mapped file, valid until commit() or destruction.
+	[[nodiscard]] std::byte * vertices() const noexcept { return vertices_; }
+	[[nodiscard]] std::byte * indices() const noexcept { return indices_; }
+
+	[[nodiscard]] const QString & path() const noexcept { return path_; }
+
+private:
+	struct Header;
+
+	[[nodiscard]] Header header(size_t vertexBytes, size_t indexBytes) const;
+	[[nodiscard]] static size_t fileSize(size_t vertexBytes, size_t indexBytes);
+	bool map(size_t vertexBytes, size_t indexBytes);
+	void unmap();
+
+	Key key_;
+	QString path_;
+	QFile file_;
+	uchar * mapped_ = nullptr;
+	size_t vertexBytes_ = 0;
+	size_t indexBytes_ = 0;
+	std::byte * vertices_ = nullptr;
+	std::byte * indices_ = nullptr;
+};
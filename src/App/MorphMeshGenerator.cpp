@@ -0,0 +1,250 @@
+#include "MorphMeshGenerator.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+constexpr float PI = 3.14159265358979323846f;
+constexpr float SNORM16_MAX = 32767.0f;
+
+int16_t toSnorm16(const float value)
+{
+	return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * SNORM16_MAX));
+}
+
+// Octahedral mapping: project onto |x| + |y| + |z| = 1 and fold the lower half over the diagonals.
+void encodeOctahedral(const float (&n)[3], int16_t (&out)[2])
+{
+	const float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+	float x = n[0] / l1;
+	float y = n[1] / l1;
+	if (n[2] / l1 < 0)
+	{
+		const float folded = 1 - std::abs(y);
+		y = (1 - std::abs(x)) * (y >= 0 ? 1.0f : -1.0f);
+		x = folded * (x >= 0 ? 1.0f : -1.0f);
+	}
+	out[0] = toSnorm16(x);
+	out[1] = toSnorm16(y);
+}
+
+// Body rings walk the cube perimeter counter-clockwise in steps of dd = 2 / (2N - 1),
+// starting half a step past (1, 0). Points landing on an edge get the diagonal normal.
+void fillCubeBodyRing(MorphVertex * const out, const size_t count, const size_t n, const float y)
+{
+	static constexpr float sideNormals[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+
+	const size_t edge = 2 * n - 1;
+	const float dd = 2.0f / static_cast<float>(edge);
+
+	// side 0 starts at corner (1, -1), the ring starts N steps into it
+	size_t side = 0;
+	size_t step = n;
+	for (size_t j = 0; j < count; j++)
+	{
+		const float local = static_cast<float>(step) * dd;
+		float x = 0, z = 0;
+		switch (side)
+		{
+			case 0:
+				x = 1, z = -1 + local;
+				break;
+			case 1:
+				x = 1 - local, z = 1;
+				break;
+			case 2:
+				x = -1, z = 1 - local;
+				break;
+			default:
+				x = -1 + local, z = -1;
+				break;
+		}
+
+		float nx = sideNormals[side][0];
+		float nz = sideNormals[side][1];
+		if (step == 0)
+		{
+			nx += sideNormals[(side + 3) % 4][0];
+			nz += sideNormals[(side + 3) % 4][1];
+		}
+
+		MorphVertex & v = out[j];
+		v.pos2[0] = x;
+		v.pos2[1] = y;
+		v.pos2[2] = z;
+		v.norm2[0] = nx;
+		v.norm2[1] = 0;
+		v.norm2[2] = nz;
+
+		if (++step == edge)
+		{
+			step = 0;
+			side = (side + 1) % 4;
+		}
+	}
+}
+}// namespace
+
+MorphMeshGenerator::MorphMeshGenerator(const size_t resolution, const MorphKernels & kernels)
+	: n_{std::max<size_t>(resolution, 1)}
+	, kernels_{&kernels}
+{
+}
+
+size_t MorphMeshGenerator::ringSize(const size_t ring) const noexcept
+{
+	if (ring < n_)
+	{
+		return 8 * ring + 4;
+	}
+	if (ring < 3 * n_ - 2)
+	{
+		return 8 * n_ - 4;
+	}
+	return 8 * (ring - (3 * n_ - 2)) + 4;
+}
+
+size_t MorphMeshGenerator::ringOffset(const size_t ring) const noexcept
+{
+	// sum of (8k + 4) for k < i is 4i^2
+	const size_t capSize = 4 * n_ * n_;
+	if (ring < n_)
+	{
+		return 4 * ring * ring;
+	}
+	if (ring < 3 * n_ - 2)
+	{
+		return capSize + (ring - n_) * (8 * n_ - 4);
+	}
+	const size_t i = ring - (3 * n_ - 2);
+	return capSize + (2 * n_ - 2) * (8 * n_ - 4) + 4 * i * i;
+}
+
+size_t MorphMeshGenerator::vertexCount() const noexcept
+{
+	return 24 * n_ * n_ - 24 * n_ + 8;
+}
+
+void MorphMeshGenerator::generateRing(const size_t ring, MorphVertex * const out) const
+{
+	const size_t numOfCircles = 4 * n_ - 2;
+	const float deltaPhi = PI / static_cast<float>(numOfCircles);
+	const size_t numOfDots = ringSize(ring);
+
+	const bool isBottom = ring >= 3 * n_ - 2;
+	const size_t latitude = isBottom ? ring - (3 * n_ - 2) : ring;
+	const float phi = isBottom ? PI - deltaPhi * (static_cast<float>(latitude) + 0.5f)
+							   : deltaPhi * (static_cast<float>(latitude) + 0.5f);
+
+	if (ring < n_ || isBottom)
+	{
+		kernels_->capRing(phi, isBottom ? -1.0f : 1.0f, numOfDots, out);
+		return;
+	}
+
+	kernels_->sphereRing(phi, numOfDots, out);
+
+	const float dd = 2.0f / static_cast<float>(2 * n_ - 1);
+	const float y = 1.0f - dd * static_cast<float>(ring - n_ + 1);
+	fillCubeBodyRing(out, numOfDots, n_, y);
+}
+
+template <typename RingFn>
+void MorphMeshGenerator::forEachRing(const size_t threadCount, RingFn && ringFn) const
+{
+	const size_t rings = ringCount();
+	const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	const size_t workers = std::min(threadCount != 0 ? threadCount : hardwareThreads, rings);
+
+	// Rings differ in size, so hand them out one at a time instead of in fixed chunks.
+	std::atomic<size_t> next{0};
+	const auto work = [&] {
+		const ProfileZone zone("morph.generate");
+		auto perWorker = ringFn;
+		for (size_t ring = next++; ring < rings; ring = next++)
+		{
+			perWorker(ring);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers - 1);
+	for (size_t i = 1; i < workers; i++)
+	{
+		threads.emplace_back([&work] {
+			Profiler::setThreadName("morph generator");
+			work();
+		});
+	}
+	work();
+
+	for (auto & thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void MorphMeshGenerator::generate(MorphVertex * const out, const size_t threadCount) const
+{
+	assert(out != nullptr);
+	forEachRing(threadCount, [this, out](const size_t ring) {
+		generateRing(ring, out + ringOffset(ring));
+	});
+}
+
+void MorphMeshGenerator::generate(PackedMorphVertex * const out, const size_t threadCount) const
+{
+	assert(out != nullptr);
+	const auto packRing = [this, out](const size_t ring, const MorphVertex * const records, const size_t count) {
+		PackedMorphVertex * const packed = out + ringOffset(ring);
+		for (size_t j = 0; j < count; j++)
+		{
+			packed[j] = pack(records[j]);
+		}
+	};
+	generateRings(packRing, threadCount);
+}
+
+void MorphMeshGenerator::generateRings(const RingSink & sink, const size_t threadCount) const
+{
+	// Every worker gets its own copy of the scratch ring.
+	std::vector<MorphVertex> scratch;
+	forEachRing(threadCount, [this, &sink, scratch](const size_t ring) mutable {
+		const size_t size = ringSize(ring);
+		scratch.resize(size);
+		generateRing(ring, scratch.data());
+		sink(ring, scratch.data(), size);
+	});
+}
+
+float MorphMeshGenerator::positionBound() noexcept
+{
+	return std::sqrt(3.0f);
+}
+
+PackedMorphVertex MorphMeshGenerator::pack(const MorphVertex & vertex) noexcept
+{
+	const float scale = 1.0f / positionBound();
+
+	PackedMorphVertex packed{};
+	for (size_t k = 0; k < 3; k++)
+	{
+		packed.pos1[k] = toSnorm16(vertex.pos1[k] * scale);
+		packed.pos2[k] = toSnorm16(vertex.pos2[k] * scale);
+	}
+	encodeOctahedral(vertex.norm1, packed.norm1);
+	encodeOctahedral(vertex.norm2, packed.norm2);
+	return packed;
+}
+
+std::vector<MorphVertex> MorphMeshGenerator::generate() const
+{
+	std::vector<MorphVertex> vertices(vertexCount());
+	generate(vertices.data());
+	return vertices;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MorphKernels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// One interleaved morph record: sphere endpoint followed by cube endpoint.
+struct MorphVertex
+{
+	float pos1[3];
+	float norm1[3];
+	float pos2[3];
+	float norm2[3];
+};
+
+static_assert(sizeof(MorphVertex) == 12 * sizeof(float), "MorphVertex must stay tightly packed");
+
+// Quantized record: positions as int16 scaled by 32767 / positionBound(),
+// unit normals octahedral-encoded into two int16 scaled by 32767.
+struct PackedMorphVertex
+{
+	int16_t pos1[3];
+	int16_t norm1[2];
+	int16_t pos2[3];
+	int16_t norm2[2];
+};
+
+static_assert(sizeof(PackedMorphVertex) == 10 * sizeof(int16_t), "PackedMorphVertex must stay tightly packed");
+
+// Builds the sphere<->cube point sets for a box of side 2N.
+// Rings are stored as: top cap (pole first), body (top to bottom), bottom cap (pole first).
+// Cap ring i holds 8i+4 points, every body ring holds 8N-4 points.
+class MorphMeshGenerator
+{
+public:
+	explicit MorphMeshGenerator(size_t resolution, const MorphKernels & kernels = MorphKernels::best());
+
+	[[nodiscard]] size_t resolution() const noexcept { return n_; }
+	[[nodiscard]] size_t ringCount() const noexcept { return 4 * n_ - 2; }
+	[[nodiscard]] size_t ringSize(size_t ring) const noexcept;
+	[[nodiscard]] size_t ringOffset(size_t ring) const noexcept;
+	[[nodiscard]] size_t vertexCount() const noexcept;
+
+	// Largest absolute position coordinate: the sphere passes through the cube corners.
+	[[nodiscard]] static float positionBound() noexcept;
+
+	// Fills vertexCount() records at out, spreading rings over threadCount workers (0 - all cores).
+	void generate(MorphVertex * out, size_t threadCount = 0) const;
+	void generate(PackedMorphVertex * out, size_t threadCount = 0) const;
+	[[nodiscard]] std::vector<MorphVertex> generate() const;
+
+	// Generates every ring into per-worker scratch and hands it to sink, concurrently from several workers.
+	using RingSink = std::function<void(size_t ring, const MorphVertex * records, size_t count)>;
+	void generateRings(const RingSink & sink, size_t threadCount = 0) const;
+
+	[[nodiscard]] static PackedMorphVertex pack(const MorphVertex & vertex) noexcept;
+
+private:
+	template <typename RingFn>
+	void forEachRing(size_t threadCount, RingFn && ringFn) const;
+	void generateRing(size_t ring, MorphVertex * out) const;
+
+	size_t n_;
+	const MorphKernels * kernels_;
+};
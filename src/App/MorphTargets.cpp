@@ -0,0 +1,107 @@
+#include "MorphTargets.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+MorphTargets::MorphTargets(const MorphMeshGenerator & generator, std::vector<MorphShape> shapes)
+	: generator_{generator}
+	, shapes_{std::move(shapes)}
+{
+	assert(!shapes_.empty() && shapes_.size() <= MAX_TARGETS);
+}
+
+size_t MorphTargets::deltaTexelCount() const noexcept
+{
+	return (targetCount() - 1) * generator_.vertexCount() * TEXELS_PER_DELTA;
+}
+
+void MorphTargets::evaluate(const MorphShape shape, const MorphVertex & record, float (&pos)[3], float (&norm)[3])
+{
+	const float bound = MorphMeshGenerator::positionBound();
+	const float dx = record.pos1[0] / bound;
+	const float dy = record.pos1[1] / bound;
+	const float dz = record.pos1[2] / bound;
+	const float r = std::sqrt(dx * dx + dz * dz);
+
+	const auto set = [](float (&v)[3], const float x, const float y, const float z) {
+		v[0] = x;
+		v[1] = y;
+		v[2] = z;
+	};
+	const auto sign = [](const float v) { return v >= 0 ? 1.0f : -1.0f; };
+
+	switch (shape)
+	{
+		case MorphShape::Sphere:
+			std::copy(std::begin(record.pos1), std::end(record.pos1), pos);
+			std::copy(std::begin(record.norm1), std::end(record.norm1), norm);
+			break;
+		case MorphShape::Cube:
+			std::copy(std::begin(record.pos2), std::end(record.pos2), pos);
+			std::copy(std::begin(record.norm2), std::end(record.norm2), norm);
+			break;
+		case MorphShape::Octahedron:
+		{
+			// Central projection onto |x| + |y| + |z| = bound.
+			const float t = bound / (std::abs(dx) + std::abs(dy) + std::abs(dz));
+			set(pos, dx * t, dy * t, dz * t);
+			set(norm, sign(dx), sign(dy), sign(dz));
+			break;
+		}
+		case MorphShape::Cylinder:
+		{
+			// Central projection onto the unit cylinder capped at y = +-1.
+			const float t = 1.0f / std::max(r, std::abs(dy));
+			set(pos, dx * t, dy * t, dz * t);
+			if (r >= std::abs(dy))
+			{
+				set(norm, dx / r, 0, dz / r);
+			}
+			else
+			{
+				set(norm, 0, sign(dy), 0);
+			}
+			break;
+		}
+		case MorphShape::Torus:
+		{
+			// Tube angle psi = PI - 2 phi with R = r = bound / 2 reduces to bound * sin(phi) * d.
+			const float tube = 1 - 2 * dy * dy;// cos(psi)
+			set(pos, bound * r * dx, bound * r * dy, bound * r * dz);
+			set(norm, tube * dx / r, 2 * r * dy, tube * dz / r);
+			break;
+		}
+	}
+}
+
+void MorphTargets::generate(BaseVertex * const base, float * const deltas) const
+{
+	assert(base != nullptr && (deltas != nullptr || targetCount() == 1));
+
+	const size_t vertexCount = generator_.vertexCount();
+	const size_t deltaStride = TEXELS_PER_DELTA * 4;
+
+	generator_.generateRings([&](const size_t ring, const MorphVertex * const records, const size_t count) {
+		const size_t offset = generator_.ringOffset(ring);
+		for (size_t j = 0; j < count; j++)
+		{
+			BaseVertex & b = base[offset + j];
+			evaluate(shapes_.front(), records[j], b.pos, b.norm);
+
+			for (size_t k = 1; k < targetCount(); k++)
+			{
+				float pos[3], norm[3];
+				evaluate(shapes_[k], records[j], pos, norm);
+
+				float * const delta = deltas + ((k - 1) * vertexCount + offset + j) * deltaStride;
+				for (size_t c = 0; c < 3; c++)
+				{
+					delta[c] = pos[c] - b.pos[c];
+					delta[4 + c] = norm[c] - b.norm[c];
+				}
+				delta[3] = delta[7] = 0;
+			}
+		}
+	});
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MorphMeshGenerator.h"
+
+#include <vector>
+
+// Shapes sharing the generator's (ring, index) parametrization.
+// All but the cube are derived from the sphere direction of each record.
+enum class MorphShape
+{
+	Sphere,
+	Cube,
+	Octahedron,
+	Cylinder,
+	Torus,// horn torus, both poles meet in its center
+};
+
+// Base shape in a vertex buffer plus deltas of the other targets,
+// so the per-vertex attribute count does not grow with the number of targets.
+class MorphTargets
+{
+public:
+	static constexpr size_t MAX_TARGETS = 8;
+
+	// Base record: position and normal of shapes.front().
+	struct BaseVertex
+	{
+		float pos[3];
+		float norm[3];
+	};
+
+	// Deltas are stored per target, then per vertex, as two RGBA32F texels (position, normal).
+	static constexpr size_t TEXELS_PER_DELTA = 2;
+
+	MorphTargets(const MorphMeshGenerator & generator, std::vector<MorphShape> shapes);
+
+	[[nodiscard]] const MorphMeshGenerator & generator() const noexcept { return generator_; }
+	[[nodiscard]] size_t targetCount() const noexcept { return shapes_.size(); }
+	[[nodiscard]] size_t deltaTexelCount() const noexcept;
+
+	// Both fill all records of the generator in one parallel pass over the rings.
+	void generate(BaseVertex * base, float * deltas) const;
+
+	static void evaluate(MorphShape shape, const MorphVertex & record, float (&pos)[3], float (&norm)[3]);
+
+private:
+	const MorphMeshGenerator & generator_;
+	std::vector<MorphShape> shapes_;
+};
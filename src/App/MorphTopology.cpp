@@ -0,0 +1,183 @@
+#include "MorphTopology.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+MorphTopology::MorphTopology(const MorphMeshGenerator & generator)
+	: generator_{generator}
+{
+}
+
+size_t MorphTopology::triangleCount() const noexcept
+{
+	// Every band between rings adds one triangle per point on both rings,
+	// each pole adds two: (2V - 4 - 4) + 4, as Euler's formula demands for a sphere.
+	return 2 * generator_.vertexCount() - 4;
+}
+
+bool MorphTopology::fitsShortIndices() const noexcept
+{
+	return generator_.vertexCount() - 1 <= std::numeric_limits<uint16_t>::max();
+}
+
+size_t MorphTopology::latitudeRing(const size_t latitude) const noexcept
+{
+	// The bottom cap is stored pole first, so walk it backwards.
+	const size_t n = generator_.resolution();
+	const size_t bottom = 3 * n - 2;
+	return latitude < bottom ? latitude : bottom + (generator_.ringCount() - 1 - latitude);
+}
+
+size_t MorphTopology::latitudeOffset(const size_t latitude) const noexcept
+{
+	const size_t n = generator_.resolution();
+	const size_t bottom = 3 * n - 2;
+	if (latitude <= bottom)
+	{
+		return generator_.ringOffset(latitude);
+	}
+	// The bottom cap rings below latitude hold 4 i^2 points.
+	const size_t below = generator_.ringCount() - latitude;
+	return generator_.vertexCount() - 4 * below * below;
+}
+
+size_t MorphTopology::bandOffset(const size_t latitude) const noexcept
+{
+	// Two north pole triangles, then every band has one triangle per point on both of its rings.
+	return 2 + latitudeOffset(latitude) + latitudeOffset(latitude + 1) - generator_.ringSize(0);
+}
+
+size_t MorphTopology::vertex(const size_t corner) const noexcept
+{
+	const size_t triangle = corner / 3;
+	const size_t k = corner % 3;
+	const size_t rings = generator_.ringCount();
+
+	if (triangle < 2 || triangle >= triangleCount() - 2)
+	{
+		// The pole fans of buildImpl.
+		const bool isNorth = triangle < 2;
+		const size_t pole = generator_.ringOffset(latitudeRing(isNorth ? 0 : rings - 1));
+		const size_t second = triangle % 2;
+		const size_t fan[2][2][3] = {{{0, 1, 2}, {0, 2, 3}}, {{0, 2, 1}, {0, 3, 2}}};
+		return pole + fan[isNorth ? 1 : 0][second][k];
+	}
+
+	// Last band starting at or before triangle.
+	size_t low = 0, high = rings - 2;
+	while (low < high)
+	{
+		const size_t middle = (low + high + 1) / 2;
+		if (bandOffset(middle) <= triangle)
+		{
+			low = middle;
+		}
+		else
+		{
+			high = middle - 1;
+		}
+	}
+	const size_t latitude = low;
+	const size_t upperRing = latitudeRing(latitude);
+	const size_t lowerRing = latitudeRing(latitude + 1);
+	const size_t upper = generator_.ringOffset(upperRing);
+	const size_t lower = generator_.ringOffset(lowerRing);
+	const size_t nu = generator_.ringSize(upperRing);
+	const size_t nl = generator_.ringSize(lowerRing);
+	const size_t step = triangle - bandOffset(latitude);
+
+	// buildImpl merges the upper steps a and lower steps b by (2a + 3) / nu against (2b + 3) / nl,
+	// upper first on ties. Upper step a therefore lands after the lower steps with a smaller key.
+	const auto upperPosition = [nu, nl](const size_t a) {
+		const size_t key = (2 * a + 3) * nl;
+		const size_t lowerBefore = key <= 3 * nu ? 0 : std::min((key - 1 - 3 * nu) / (2 * nu) + 1, nl);
+		return a + lowerBefore;
+	};
+
+	// Upper steps taken before this one.
+	size_t a = 0;
+	high = nu;
+	while (a < high)
+	{
+		const size_t middle = (a + high) / 2;
+		if (upperPosition(middle) < step)
+		{
+			a = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	const size_t b = step - a;
+	if (a < nu && upperPosition(a) == step)
+	{
+		const size_t corners[3] = {upper + a, upper + (a + 1) % nu, lower + b % nl};
+		return corners[k];
+	}
+	const size_t corners[3] = {upper + a % nu, lower + (b + 1) % nl, lower + b};
+	return corners[k];
+}
+
+template <typename Index>
+void MorphTopology::buildImpl(Index * out) const
+{
+	[[maybe_unused]] const Index * const begin = out;
+	const auto emit = [&out](const size_t a, const size_t b, const size_t c) {
+		*out++ = static_cast<Index>(a);
+		*out++ = static_cast<Index>(b);
+		*out++ = static_cast<Index>(c);
+	};
+
+	const size_t rings = generator_.ringCount();
+
+	// North pole, viewed from above the ring runs clockwise.
+	const size_t north = generator_.ringOffset(latitudeRing(0));
+	emit(north, north + 2, north + 1);
+	emit(north, north + 3, north + 2);
+
+	for (size_t latitude = 0; latitude + 1 < rings; latitude++)
+	{
+		const size_t upperRing = latitudeRing(latitude);
+		const size_t lowerRing = latitudeRing(latitude + 1);
+		const size_t upper = generator_.ringOffset(upperRing);
+		const size_t lower = generator_.ringOffset(lowerRing);
+		const size_t nu = generator_.ringSize(upperRing);
+		const size_t nl = generator_.ringSize(lowerRing);
+
+		// Point j sits at theta = 2 PI (j + 0.5) / n, step on the ring whose next point comes first.
+		size_t a = 0, b = 0;
+		while (a < nu || b < nl)
+		{
+			const bool stepUpper = b == nl || (a < nu && (2 * a + 3) * nl <= (2 * b + 3) * nu);
+			if (stepUpper)
+			{
+				emit(upper + a, upper + (a + 1) % nu, lower + b % nl);
+				a++;
+			}
+			else
+			{
+				emit(upper + a % nu, lower + (b + 1) % nl, lower + b);
+				b++;
+			}
+		}
+	}
+
+	const size_t south = generator_.ringOffset(latitudeRing(rings - 1));
+	emit(south, south + 1, south + 2);
+	emit(south, south + 2, south + 3);
+
+	assert(static_cast<size_t>(out - begin) == indexCount());
+}
+
+void MorphTopology::build(uint16_t * const out) const
+{
+	assert(fitsShortIndices());
+	buildImpl(out);
+}
+
+void MorphTopology::build(uint32_t * const out) const
+{
+	buildImpl(out);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "MorphMeshGenerator.h"
+
+#include <cstdint>
+
+// Triangle list over the generator's rings, ordered north to south.
+// Pole rings are closed with two triangles, neighbouring rings are zipped together
+// by walking both in theta order, which copes with 8i+4 against 8(i+1)+4 points.
+// Sphere and cube endpoints share the parametrization, so one topology serves both.
+class MorphTopology
+{
+public:
+	explicit MorphTopology(const MorphMeshGenerator & generator);
+
+	[[nodiscard]] size_t triangleCount() const noexcept;
+	[[nodiscard]] size_t indexCount() const noexcept { return 3 * triangleCount(); }
+	// 16-bit indices suffice while every vertex id fits into uint16_t.
+	[[nodiscard]] bool fitsShortIndices() const noexcept;
+
+	// Writes indexCount() counter-clockwise (outward facing) indices.
+	void build(uint16_t * out) const;
+	void build(uint32_t * out) const;
+
+	// Closed form of build(): the vertex id at position corner of the index list.
+	// morth.vs mirrors it to draw procedural morphs without an index buffer.
+	[[nodiscard]] size_t vertex(size_t corner) const noexcept;
+
+private:
+	template <typename Index>
+	void buildImpl(Index * out) const;
+
+	[[nodiscard]] size_t latitudeRing(size_t latitude) const noexcept;
+	// Points on the latitudes above latitude.
+	[[nodiscard]] size_t latitudeOffset(size_t latitude) const noexcept;
+	// First triangle of the band between latitude and latitude + 1.
+	[[nodiscard]] size_t bandOffset(size_t latitude) const noexcept;
+
+	const MorphMeshGenerator & generator_;
+};
@@ -1,215 +1,518 @@
 #include "Morth.h"
+#include "MorphMeshCache.h"
+#include "MorphMeshGenerator.h"
+#include "MorphTopology.h"
+#include "Profiler.h"
+
+#include <QFile>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
 
 #include <algorithm>
+#include <array>
+#include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
 #include <vector>
 
-void Morth::init(Window * const wnd)
+namespace
 {
-	static constexpr size_t N = 60;// 2N - side of box
-	float PI = acos(-1);
+// Sizes go to GL directly: QOpenGLBuffer takes int, which would cap morph levels at 2 GB.
+constexpr size_t MAX_BUFFER_BYTES = static_cast<size_t>(std::numeric_limits<GLsizeiptr>::max());
 
-	// x1 y1 z1 nx1 ny1 nz1 x2 y2 z2 nx2 xy2 nz2
-	std::vector<GLfloat> vertices;
-	std::vector<GLfloat> sphereVertices;
-	std::vector<GLfloat> cubeVertices;
-	std::vector<size_t> indices;
+// Sizes the bound buffer, copying data when given. Fails when the driver could not allocate all of it.
+bool allocateBuffer(QOpenGLExtraFunctions & gl, const QOpenGLBuffer & buffer, const void * const data,
+					const size_t byteSize)
+{
+	const auto target = static_cast<GLenum>(buffer.type());
+	gl.glBufferData(target, static_cast<GLsizeiptr>(byteSize), data, static_cast<GLenum>(buffer.usagePattern()));
+	GLint64 allocated = 0;
+	gl.glGetBufferParameteri64v(target, GL_BUFFER_SIZE, &allocated);
+	return static_cast<size_t>(allocated) == byteSize;
+}
+
+// Reads a shader resource and injects preprocessor defines right after its #version line.
+QByteArray loadShaderSource(const QString & path, const std::vector<QByteArray> & defines)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		std::cerr << "Failed to open shader: " << path.toStdString() << std::endl;
+		return {};
+	}
 
-	size_t numOfCircles = 4 * N - 2;
-	float deltaPhi = PI / numOfCircles;
-	float phi = deltaPhi / 2.0f;
+	QByteArray source = file.readAll();
+	QByteArray header;
+	for (const auto & define : defines)
+	{
+		header += "#define " + define + "\n";
+	}
+	source.insert(source.indexOf('\n') + 1, header);
+	return source;
+}
 
-	// top
-	for (size_t i = 0; i < N; i++)
+// Manual mode walks the target chain with lerp in [0, 1] spanning all of it, values outside extrapolate
+// the first or last segment. Otherwise every target is held in turn with a smooth blend into the next one.
+std::array<GLfloat, MorphTargets::MAX_TARGETS> targetWeights(const size_t count, const bool manual, const float lerp,
+															 const float time)
+{
+	std::array<GLfloat, MorphTargets::MAX_TARGETS> weights{};
+	if (count == 1)
 	{
-		size_t numOfDots = 8 * i + 4;
+		weights[0] = 1;
+		return weights;
+	}
 
-		for (size_t j = 0; j < numOfDots; j++)
+	if (manual)
+	{
+		const float t = lerp * static_cast<float>(count - 1);
+		const auto segment = static_cast<size_t>(std::clamp(std::floor(t), 0.0f, static_cast<float>(count - 2)));
+		const float f = t - static_cast<float>(segment);
+		weights[segment] = 1 - f;
+		weights[segment + 1] = f;
+	}
+	else
+	{
+		const float phase = std::fmod(time, static_cast<float>(count));
+		const auto segment = std::min(static_cast<size_t>(phase), count - 1);
+		const float f = phase - static_cast<float>(segment);
+		const float blend = f * f * (3 - 2 * f);
+		weights[segment] = 1 - blend;
+		weights[(segment + 1) % count] += blend;
+	}
+	return weights;
+}
+}// namespace
+
+Morth::Morth(const MorthSettings & settings)
+	: settings_{settings}
+{
+}
+
+void Morth::init(Window * const wnd)
+{
+	assert(!settings_.lodResolutions.empty());
+	assert(std::is_sorted(settings_.lodResolutions.begin(), settings_.lodResolutions.end()));
+
+	if (settings_.source == MorthSettings::Source::Targets)
+	{
+		// Base records and deltas share the VBO, the texture buffer has to cover all of it on the finest level.
+		const MorphMeshGenerator generator{settings_.lodResolutions.back()};
+		const MorphTargets targets{generator, settings_.targets};
+		GLint maxTexels = 0;
+		wnd->glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		const size_t texels = generator.vertexCount() * sizeof(MorphTargets::BaseVertex) / (4 * sizeof(float))
+			+ targets.deltaTexelCount();
+		if (texels > static_cast<size_t>(maxTexels))
 		{
-			float theta = 2.0 * PI * ((float)j + 0.5) / numOfDots;
-			float s = sin(phi);
-			float x = s * (float)cos(theta);
-			float y = (float)cos(phi);
-			float z = s * (float)sin(theta);
-
-			float x1 = -x / y;
-			float z1 = -z / y;
-
-			float k = sqrt(x1 * x1 + z1 * z1) / (std::max(abs(x1), abs(z1)));
-			sphereVertices.insert(sphereVertices.end(), {x, y, z, x, y, z});
-			cubeVertices.insert(cubeVertices.end(), {k * x / y, 1, k * z / y, 0, 1, 0});
+			std::cerr << "Morph target deltas exceed GL_MAX_TEXTURE_BUFFER_SIZE, falling back to two endpoints"
+					  << std::endl;
+			settings_.source = MorthSettings::Source::Buffer;
 		}
-		phi += deltaPhi;
 	}
-	// body
-	for (size_t i = 0; i < 2 * N - 2; i++)
+
+	std::vector<QByteArray> defines;
+	switch (settings_.source)
 	{
-		size_t numOfDots = 8 * N - 4;
+		case MorthSettings::Source::Buffer:
+			if (settings_.format == MorthSettings::Format::Packed)
+			{
+				defines.emplace_back("MORTH_PACKED");
+			}
+			break;
+		case MorthSettings::Source::Procedural:
+			defines.emplace_back("MORTH_PROCEDURAL");
+			break;
+		case MorthSettings::Source::Targets:
+			defines.emplace_back("MORTH_TARGETS");
+			break;
+	}
 
-		for (size_t j = 0; j < numOfDots; j++)
-		{
-			float theta = 2.0 * PI * ((float)j + 0.5) / numOfDots;
-			float s = (float)sin(phi);
-			float x = s * (float)cos(theta);
-			float y = (float)cos(phi);
-			float z = s * (float)sin(theta);
+	program_ = std::make_unique<QOpenGLShaderProgram>(wnd);
+	program_->addShaderFromSourceCode(QOpenGLShader::Vertex, loadShaderSource(":/Shaders/morth.vs", defines));
+	program_->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/Shaders/morth.fs");
+	program_->link();
 
-			sphereVertices.insert(sphereVertices.end(), {x, y, z, x, y, z});
-		}
-		phi += deltaPhi;
-
-		float dd = 2.0f / (2 * N - 1);
-		float y = 1.0f - dd * (1 + i);
-    float x = 1, z = dd / 2.0f;
-    for (size_t j = 0; j < N - 1; j++)
-    {
-      cubeVertices.insert(cubeVertices.end(), {x, y, z, 1, 0, 0});
-      z += dd;
-    }
-    cubeVertices.insert(cubeVertices.end(), {x = 1, y, z = 1, 1, 0, 1});
-    for (size_t j = 0; j < 2 * N - 2; j++)
-    {
-      x -= dd;
-      cubeVertices.insert(cubeVertices.end(), {x, y, z, 0, 0, 1});
-    }
-    cubeVertices.insert(cubeVertices.end(), {x = -1, y, z = 1, -1, 0, 1});
-    for (size_t j = 0; j < 2 * N - 2; j++)
-    {
-      z -= dd;
-      cubeVertices.insert(cubeVertices.end(), {x, y, z, -1, 0, 0});
-    }
-    cubeVertices.insert(cubeVertices.end(), {x = -1, y, z = -1, -1, 0, -1});
-    for (size_t j = 0; j < 2 * N - 2; j++)
-    {
-      x += dd;
-      cubeVertices.insert(cubeVertices.end(), {x, y, z, 0, 0, -1});
-    }
-    cubeVertices.insert(cubeVertices.end(), {x = 1, y, z = -1, 1, 0, -1});
-    for (size_t j = 0; j < N - 1; j++)
-    {
-      z += dd;
-      cubeVertices.insert(cubeVertices.end(), {x, y, z, 1, 0, 0});
-    }
-	}
-
-	// bottom
-	phi = PI - deltaPhi / 2.0f;
-	for (size_t i = 0; i < N; i++)
-	{
-		size_t numOfDots = 8 * i + 4;
-
-		for (size_t j = 0; j < numOfDots; j++)
+	mvpUniform_ = program_->uniformLocation("mvp");
+	timeUniform_ = program_->uniformLocation("time");
+  modeUniform_ = program_->uniformLocation("mode");
+  lerpUniform_ = program_->uniformLocation("lerp");
+  enableManualUniform_ = program_->uniformLocation("enableManual");
+	resolutionUniform_ = program_->uniformLocation("resolution");
+	positionScaleUniform_ = program_->uniformLocation("positionScale");
+	targetDeltasUniform_ = program_->uniformLocation("targetDeltas");
+	targetCountUniform_ = program_->uniformLocation("targetCount");
+	deltaOffsetUniform_ = program_->uniformLocation("deltaOffset");
+	vertexCountUniform_ = program_->uniformLocation("vertexCount");
+	weightsUniform_ = program_->uniformLocation("weights");
+
+	lods_.clear();
+	lods_.resize(settings_.lodResolutions.size());
+	lod_ = 0;
+	lod(wnd, lod_);
+}
+
+Morth::Lod & Morth::lod(Window * const wnd, const size_t index)
+{
+	auto & lod = lods_[index];
+	if (!lod)
+	{
+		lod = std::make_unique<Lod>();
+		lod->resolution = settings_.lodResolutions[index];
+		buildLod(wnd, *lod);
+	}
+	return *lod;
+}
+
+void Morth::buildLod(Window * const wnd, Lod & lod)
+{
+	const ProfileZone zone("morth.build");
+
+	// x1 y1 z1 nx1 ny1 nz1 x2 y2 z2 nx2 xy2 nz2
+	const MorphMeshGenerator generator{lod.resolution};
+	const MorphTopology topology{generator};
+
+	const MorphTargets targets{generator, settings_.targets};
+
+	lod.vao.create();
+	lod.vao.bind();
+
+	BufferContents vertices;
+	switch (settings_.source)
+	{
+		case MorthSettings::Source::Procedural:
+			// No buffers at all, the shader rebuilds every triangle corner from gl_VertexID.
+			lod.geometry.vertexCount = topology.indexCount();
+			lod.vao.release();
+			return;
+		case MorthSettings::Source::Targets:
+			// basePos (location=0), baseNorm (location=1), deltas are fetched by gl_VertexID
+			lod.geometry.layout.add(0, GL_FLOAT, 3).add(1, GL_FLOAT, 3);
+			assert(lod.geometry.layout.stride == sizeof(MorphTargets::BaseVertex));
+			vertices = targetContents(lod, targets);
+			break;
+		case MorthSettings::Source::Buffer:
+			// pos1 (location=0), norm1 (location=1), pos2 (location=2), norm2 (location=3)
+			if (settings_.format == MorthSettings::Format::Packed)
+			{
+				// Raw int16 values, morth.vs applies the scales and decodes the normals.
+				lod.geometry.layout.add(0, GL_SHORT, 3).add(1, GL_SHORT, 2).add(2, GL_SHORT, 3).add(3, GL_SHORT, 2);
+				assert(lod.geometry.layout.stride == sizeof(PackedMorphVertex));
+			}
+			else
+			{
+				lod.geometry.layout.add(0, GL_FLOAT, 3).add(1, GL_FLOAT, 3).add(2, GL_FLOAT, 3).add(3, GL_FLOAT, 3);
+				assert(lod.geometry.layout.stride == sizeof(MorphVertex));
+			}
+			vertices = vertexContents(lod, generator);
+			break;
+	}
+
+	lod.vbo.create();
+	lod.vbo.bind();
+	lod.vbo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+
+	lod.ibo.create();
+	lod.ibo.bind();
+	lod.ibo.setUsagePattern(QOpenGLBuffer::StaticDraw);
+
+	if (!upload(lod, vertices, indexContents(lod, topology)))
+	{
+		// Nothing got uploaded, the level draws nothing.
+		lod.geometry.vertexCount = 0;
+		lod.geometry.indexCount = 0;
+	}
+
+	lod.geometry.setAttributeBuffers(*wnd);
+
+	lod.vao.release();
+	lod.vbo.release();
+	lod.ibo.release();
+
+	if (settings_.source == MorthSettings::Source::Targets)
+	{
+		lod.deltaTexture = std::make_unique<QOpenGLTexture>(QOpenGLTexture::TargetBuffer);
+		lod.deltaTexture->create();
+		lod.deltaTexture->bind();
+		// RGBA32F: three-component buffer formats need GL 4.0.
+		QOpenGLContext::currentContext()->extraFunctions()->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lod.vbo.bufferId());
+		lod.deltaTexture->release();
+	}
+}
+
+bool Morth::selectLod(Window * const wnd, const QMatrix4x4 & model, const QMatrix4x4 & mvp, const QSize viewport)
+{
+	// Every shape fits into the sphere of radius positionBound() around the model origin.
+	const float radius = MorphMeshGenerator::positionBound();
+
+	// Frustum planes in model space are sums and differences of the rows of mvp (Gribb, Hartmann).
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (const float sign : {1.0f, -1.0f})
 		{
-			float theta = 2.0 * PI * ((float)j + 0.5) / numOfDots;
-			float s = sin(phi);
-			float x = s * (float)cos(theta);
-			float y = (float)cos(phi);
-			float z = s * (float)sin(theta);
-			float x1 = -x / y;
-			float z1 = -z / y;
-			float k = -sqrt(x1 * x1 + z1 * z1) / (std::max(abs(x1), abs(z1)));
-
-			sphereVertices.insert(sphereVertices.end(), {x, y, z, x, y, z});
-			cubeVertices.insert(cubeVertices.end(), {k * x / y, -1, k * z / y, 0, -1, 0});
+			const QVector4D plane = mvp.row(3) + sign * mvp.row(axis);
+			const float length = plane.toVector3D().length();
+			if (length > 0 && plane.w() < -radius * length)
+			{
+				return false;
+			}
 		}
+	}
 
-		phi -= deltaPhi;
+	// Only with the camera inside the sphere does the object cover the whole screen.
+	float radiusPixels = std::numeric_limits<float>::max();
+	const QVector4D center = mvp * QVector4D(0, 0, 0, 1);
+	const bool cameraInside = model.inverted().map(wnd->userPos_).length() <= radius;
+	if (!cameraInside && center.w() > 0)
+	{
+		// The longest screen-space image of the three radius vectors, close enough for a LOD metric.
+		radiusPixels = 0;
+		for (const auto & axis : {QVector4D(radius, 0, 0, 0), QVector4D(0, radius, 0, 0), QVector4D(0, 0, radius, 0)})
+		{
+			const QVector4D edge = center + mvp * axis;
+			if (edge.w() <= 0)
+			{
+				// The camera is inside or right next to the object.
+				radiusPixels = std::numeric_limits<float>::max();
+				break;
+			}
+			const float dx = (edge.x() / edge.w() - center.x() / center.w()) * static_cast<float>(viewport.width()) / 2;
+			const float dy = (edge.y() / edge.w() - center.y() / center.w()) * static_cast<float>(viewport.height()) / 2;
+			radiusPixels = std::max(radiusPixels, std::sqrt(dx * dx + dy * dy));
+		}
 	}
 
-  float s3 = sqrt(3);
-  for (size_t i = 0; i < sphereVertices.size(); i += 6)
-  {
-    vertices.insert(vertices.end(), {
-      sphereVertices[i] * s3, sphereVertices[i + 1] * s3, sphereVertices[i + 2] * s3,
-      sphereVertices[i + 3] * s3, sphereVertices[i + 4] * s3, sphereVertices[i + 5] * s3,
-      cubeVertices[i], cubeVertices[i + 1], cubeVertices[i + 2],
-      cubeVertices[i + 3], cubeVertices[i + 4], cubeVertices[i + 5] 
-    });
-  }
+	// 4N - 2 rings span half of the silhouette circumference.
+	const float wanted = 3.14159265f * radiusPixels / (4 * settings_.lodRingPixels);
+	const auto & resolutions = settings_.lodResolutions;
+	while (lod_ + 1 < resolutions.size() && static_cast<float>(resolutions[lod_]) < wanted)
+	{
+		lod_++;
+	}
+	while (lod_ > 0 && static_cast<float>(resolutions[lod_ - 1]) >= wanted * (1 + settings_.lodHysteresis))
+	{
+		lod_--;
+	}
+	return true;
+}
 
+Morth::BufferContents Morth::vertexContents(Lod & lod, const MorphMeshGenerator & generator) const
+{
+	// The layout already describes the chosen record format.
+	const bool packed = lod.geometry.layout.stride == sizeof(PackedMorphVertex);
+	const size_t bufferSize = generator.vertexCount() * lod.geometry.layout.stride;
+	lod.geometry.setVertexBytes(bufferSize);
 
-	program_ = std::make_unique<QOpenGLShaderProgram>(wnd);
-	program_->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/Shaders/morth.vs");
-	program_->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/Shaders/morth.fs");
-	program_->link();
+	const auto generate = [&generator, packed](void * const out) {
+		if (packed)
+		{
+			generator.generate(static_cast<PackedMorphVertex *>(out));
+		}
+		else
+		{
+			generator.generate(static_cast<MorphVertex *>(out));
+		}
+	};
 
-	vao_.create();
-	vao_.bind();
+	return {bufferSize, generate};
+}
 
-	vbo_.create();
-	vbo_.bind();
-	vbo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	vbo_.allocate(vertices.data(), static_cast<int>(vertices.size() * sizeof(GLfloat)));
+Morth::BufferContents Morth::targetContents(Lod & lod, const MorphTargets & targets) const
+{
+	// [base records | deltas], the base size is a multiple of a texel since the vertex count is even.
+	const size_t baseSize = lod.geometry.layout.stride * targets.generator().vertexCount();
+	const size_t texelSize = 4 * sizeof(float);
+	assert(baseSize % texelSize == 0);
+	lod.geometry.vertexCount = targets.generator().vertexCount();
+	lod.deltaOffset = baseSize / texelSize;
+
+	const auto generate = [&targets, baseSize](void * const out) {
+		targets.generate(static_cast<MorphTargets::BaseVertex *>(out),
+						 reinterpret_cast<float *>(static_cast<std::byte *>(out) + baseSize));
+	};
+
+	return {baseSize + targets.deltaTexelCount() * texelSize, generate};
+}
 
-	ibo_.create();
-	ibo_.bind();
-	ibo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	ibo_.allocate(indices.data(), static_cast<int>(indices.size() * sizeof(GLuint)));
+Morth::BufferContents Morth::indexContents(Lod & lod, const MorphTopology & topology) const
+{
+	const bool shortIndices = topology.fitsShortIndices();
+	const size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+	lod.geometry.setIndices(shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, topology.indexCount());
 
-	program_->bind();
+	const auto build = [&topology, shortIndices](void * const out) {
+		if (shortIndices)
+		{
+			topology.build(static_cast<uint16_t *>(out));
+		}
+		else
+		{
+			topology.build(static_cast<uint32_t *>(out));
+		}
+	};
 
-	size_t offset = 0;
-	size_t fullSize = sizeof(GLfloat) * 12;
+	return {topology.indexCount() * indexSize, build};
+}
 
-	// pos1 (location=0)
-	program_->enableAttributeArray(0);
-	program_->setAttributeBuffer(0, GL_FLOAT, offset, 3, fullSize);
-	offset += 3 * sizeof(GLfloat);
+bool Morth::upload(Lod & lod, const BufferContents & vertices, const BufferContents & indices)
+{
+	const ProfileZone zone("morth.upload");
 
-	// norm1 (location=1)
-	program_->enableAttributeArray(1);
-	program_->setAttributeBuffer(1, GL_FLOAT, offset, 3, fullSize);
-	offset += 3 * sizeof(GLfloat);
+	if (vertices.byteSize > MAX_BUFFER_BYTES || indices.byteSize > MAX_BUFFER_BYTES)
+	{
+		std::cerr << "Morph level of resolution " << lod.resolution << " needs " << vertices.byteSize << " vertex and "
+				  << indices.byteSize << " index bytes, more than GL can address" << std::endl;
+		return false;
+	}
 
-	// pos2 (location=2)
-	program_->enableAttributeArray(2);
-	program_->setAttributeBuffer(2, GL_FLOAT, offset, 3, fullSize);
-	offset += 3 * sizeof(GLfloat);
+	if (settings_.diskCache)
+	{
+		// Only what the generated bytes depend on goes into the key.
+		MorphMeshCache::Key key;
+		key.resolution = static_cast<uint32_t>(lod.resolution);
+		key.source = static_cast<uint32_t>(settings_.source);
+		if (settings_.source == MorthSettings::Source::Buffer)
+		{
+			key.format = static_cast<uint32_t>(settings_.format);
+		}
+		if (settings_.source == MorthSettings::Source::Targets)
+		{
+			key.shapes = settings_.targets;
+		}
 
-	// norm2 (location=3)
-	program_->enableAttributeArray(3);
-	program_->setAttributeBuffer(3, GL_FLOAT, offset, 3, fullSize);
+		MorphMeshCache cache{std::move(key)};
+		const bool hit = cache.load(vertices.byteSize, indices.byteSize);
+		if (hit || cache.create(vertices.byteSize, indices.byteSize))
+		{
+			if (!hit)
+			{
+				vertices.fill(cache.vertices());
+				indices.fill(cache.indices());
+			}
+
+			// Straight from the mapped file, no generation and no staging copy.
+			auto & gl = *QOpenGLContext::currentContext()->extraFunctions();
+			const bool allocated = allocateBuffer(gl, lod.vbo, cache.vertices(), vertices.byteSize)
+				&& allocateBuffer(gl, lod.ibo, cache.indices(), indices.byteSize);
+			if (!allocated)
+			{
+				std::cerr << "Failed to allocate morph buffers of resolution " << lod.resolution << std::endl;
+			}
+
+			if (!hit)
+			{
+				cache.commit();
+			}
+			return allocated;
+		}
+	}
 
-	vertexCount_ = vertices.size();
-	indexCount_ = indices.size();
+	return fillBuffer(lod.vbo, vertices, "vertex") && fillBuffer(lod.ibo, indices, "index");
+}
 
-	mvpUniform_ = program_->uniformLocation("mvp");
-	timeUniform_ = program_->uniformLocation("time");
-  modeUniform_ = program_->uniformLocation("mode");
-  lerpUniform_ = program_->uniformLocation("lerp");
-  enableManualUniform_ = program_->uniformLocation("enableManual");
+bool Morth::fillBuffer(QOpenGLBuffer & buffer, const BufferContents & contents, const char * const name) const
+{
+	if (contents.byteSize > MAX_BUFFER_BYTES)
+	{
+		std::cerr << "Morph " << name << " buffer of " << contents.byteSize << " bytes is too large" << std::endl;
+		return false;
+	}
+	auto & gl = *QOpenGLContext::currentContext()->extraFunctions();
+	const auto target = static_cast<GLenum>(buffer.type());
+	if (settings_.upload == MorthSettings::Upload::Mapped)
+	{
+		// Size the buffer up front and let the generators write in place.
+		if (!allocateBuffer(gl, buffer, nullptr, contents.byteSize))
+		{
+			std::cerr << "Failed to allocate " << contents.byteSize << " bytes for the morph " << name << " buffer"
+					  << std::endl;
+			return false;
+		}
+		void * const mapped = gl.glMapBufferRange(target, 0, static_cast<GLsizeiptr>(contents.byteSize),
+												  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped != nullptr)
+		{
+			contents.fill(mapped);
+			if (gl.glUnmapBuffer(target) == GL_TRUE)
+			{
+				return true;
+			}
+		}
+		std::cerr << "Failed to map morph " << name << " buffer, falling back to staged upload" << std::endl;
+	}
 
-	program_->release();
-	vao_.release();
-	vbo_.release();
-	ibo_.release();
+	std::vector<std::byte> data(contents.byteSize);
+	contents.fill(data.data());
+	if (!allocateBuffer(gl, buffer, data.data(), contents.byteSize))
+	{
+		std::cerr << "Failed to allocate " << contents.byteSize << " bytes for the morph " << name << " buffer" << std::endl;
+		return false;
+	}
+	return true;
 }
 
-void Morth::render(Window * const wnd, const QMatrix4x4 & viewProjection)
+void Morth::render(Window * const wnd, const QMatrix4x4 & viewProjection, const QSize viewport)
 {
-	program_->bind();
-	vao_.bind();
+	const ProfileZone zone("morth.render");
 
 	QMatrix4x4 scale;
 	scale.translate(0, 10, 20);
 	scale.scale(5.0f);
-	program_->setUniformValue(mvpUniform_, viewProjection * scale);
-	program_->setUniformValue(timeUniform_, (float)clock() / CLOCKS_PER_SEC);
-  program_->setUniformValue(modeUniform_, wnd->mode_);
-  program_->setUniformValue(lerpUniform_, wnd->interpolation_);
-  program_->setUniformValue(enableManualUniform_, wnd->enableManual_);
+	const QMatrix4x4 mvp = viewProjection * scale;
 
-	// Activate texture unit and bind texture
-	wnd->glActiveTexture(GL_TEXTURE0);
+	// Off screen: no draw, and no level gets built for it.
+	if (!selectLod(wnd, scale, mvp, viewport))
+	{
+		return;
+	}
+	Lod & level = lod(wnd, lod_);
 
-	// wnd->glDrawElements(GL_TRIANGLES, indexCount_, GL_UNSIGNED_INT, nullptr);
-	wnd->glDrawArrays(GL_POINTS, 0, vertexCount_);
+	program_->bind();
+	level.vao.bind();
+
+	{
+		const ProfileZone uniformsZone("morth.uniforms");
+		program_->setUniformValue(mvpUniform_, mvp);
+		program_->setUniformValue(timeUniform_, wnd->animationTime());
+		program_->setUniformValue(modeUniform_, wnd->mode_);
+		program_->setUniformValue(lerpUniform_, wnd->interpolation_);
+		program_->setUniformValue(enableManualUniform_, wnd->enableManual_);
+		program_->setUniformValue(resolutionUniform_, static_cast<GLint>(level.resolution));
+		program_->setUniformValue(positionScaleUniform_, MorphMeshGenerator::positionBound() / 32767.0f);
+
+		// Activate texture unit and bind texture
+		wnd->glActiveTexture(GL_TEXTURE0);
+
+		if (level.deltaTexture)
+		{
+			const auto weights = targetWeights(settings_.targets.size(), wnd->enableManual_, wnd->interpolation_, wnd->animationTime());
+			level.deltaTexture->bind();
+			program_->setUniformValue(targetDeltasUniform_, 0);
+			program_->setUniformValue(targetCountUniform_, static_cast<GLint>(settings_.targets.size()));
+			program_->setUniformValue(deltaOffsetUniform_, static_cast<GLint>(level.deltaOffset));
+			program_->setUniformValue(vertexCountUniform_, static_cast<GLint>(level.geometry.vertexCount));
+			program_->setUniformValueArray(weightsUniform_, weights.data(), static_cast<int>(weights.size()), 1);
+		}
+	}
+
+	{
+		const ProfileZone drawZone("morth.draw");
+		level.geometry.draw(*wnd);
+	}
+
+	if (level.deltaTexture)
+	{
+		level.deltaTexture->release();
+	}
 
-	vao_.release();
+	level.vao.release();
 	program_->release();
 }
 
 void Morth::release()
 {
+	lods_.clear();
 	program_.reset();
 }
@@ -1,7 +1,46 @@
 #pragma once
 
+#include "Geometry.h"
+#include "MorphTargets.h"
 #include "Window.h"
 
+class MorphMeshGenerator;
+class MorphTopology;
+
+struct MorthSettings
+{
+	enum class Upload
+	{
+		Staged,// generate into host memory, then copy into the VBO
+		Mapped,// generate straight into the mapped VBO
+	};
+
+	enum class Source
+	{
+		Buffer,    // vertex records generated on the CPU
+		Procedural,// triangle corners rebuilt in morth.vs from gl_VertexID, no VBO or IBO
+		Targets,   // base shape in the VBO, deltas of the other targets in a texture buffer
+	};
+
+	enum class Format
+	{
+		Float, // 48 B: float positions and normals
+		Packed,// 20 B: snorm16 positions, octahedral snorm16 normals
+	};
+
+	// LOD chain, finest last. N is half the number of dots on a side of the box.
+	std::vector<size_t> lodResolutions = {8, 16, 32, 64, 128};
+	float lodRingPixels = 4.0f;// wanted on-screen distance between neighbouring rings
+	float lodHysteresis = 0.25f;// a coarser level needs this much headroom before switching down
+	Upload upload = Upload::Mapped;
+	Source source = Source::Buffer;
+	Format format = Format::Float;
+	bool diskCache = true;// memory-map meshes generated by earlier runs, see MorphMeshCache
+	// Source::Targets only, blended in this order
+	std::vector<MorphShape> targets = {
+		MorphShape::Sphere, MorphShape::Cube, MorphShape::Octahedron, MorphShape::Cylinder, MorphShape::Torus};
+};
+
 class Morth
 {
 private:
@@ -10,18 +49,66 @@ private:
   GLint modeUniform_ = -1;
   GLint lerpUniform_ = -1;
   GLint enableManualUniform_ = -1;
+	GLint resolutionUniform_ = -1;
+	GLint positionScaleUniform_ = -1;
+	GLint targetDeltasUniform_ = -1;
+	GLint targetCountUniform_ = -1;
+	GLint deltaOffsetUniform_ = -1;
+	GLint vertexCountUniform_ = -1;
+	GLint weightsUniform_ = -1;
+
+	// One level of the LOD chain, built the first time it gets selected.
+	struct Lod
+	{
+		size_t resolution = 0;
 
-	QOpenGLBuffer vbo_{QOpenGLBuffer::Type::VertexBuffer};
-	QOpenGLBuffer ibo_{QOpenGLBuffer::Type::IndexBuffer};
-	QOpenGLVertexArrayObject vao_;
+		QOpenGLBuffer vbo{QOpenGLBuffer::Type::VertexBuffer};
+		QOpenGLBuffer ibo{QOpenGLBuffer::Type::IndexBuffer};
+		QOpenGLVertexArrayObject vao;
 
-	size_t indexCount_ = 0;
-	size_t vertexCount_ = 0;
+		Geometry geometry;
+
+		// Views the whole VBO, target deltas start at deltaOffset texels.
+		std::unique_ptr<QOpenGLTexture> deltaTexture;
+		size_t deltaOffset = 0;
+	};
+
+	std::vector<std::unique_ptr<Lod>> lods_;
+	size_t lod_ = 0;
 
 	std::unique_ptr<QOpenGLShaderProgram> program_;
 
+	MorthSettings settings_;
+
+	Lod & lod(Window * wnd, size_t index);
+	void buildLod(Window * wnd, Lod & lod);
+	// Picks the level from the projected radius of the bounding sphere, with hysteresis.
+	// Returns false, keeping the current level, when the sphere is outside the view frustum.
+	bool selectLod(Window * wnd, const QMatrix4x4 & model, const QMatrix4x4 & mvp, QSize viewport);
+
+	// Byte size of a buffer and how to write its contents in place.
+	struct BufferContents
+	{
+		size_t byteSize = 0;
+		std::function<void(void *)> fill;
+	};
+
+	// These also describe the records in lod.geometry.
+	BufferContents vertexContents(Lod & lod, const MorphMeshGenerator & generator) const;
+	BufferContents targetContents(Lod & lod, const MorphTargets & targets) const;
+	BufferContents indexContents(Lod & lod, const MorphTopology & topology) const;
+
+	// Uploads both into the bound buffers of lod, going through the disk cache when enabled.
+	// Fails when the driver cannot allocate buffers that large.
+	bool upload(Lod & lod, const BufferContents & vertices, const BufferContents & indices);
+	// Maps the bound buffer and lets fill write it in place, falls back to a staged copy.
+	bool fillBuffer(QOpenGLBuffer & buffer, const BufferContents & contents, const char * name) const;
+
 public:
+	explicit Morth(const MorthSettings & settings = {});
+
 	void init(Window * const wnd);
-	void render(Window * const wnd, const QMatrix4x4 & viewProjection);
+	// viewport: size of the render target in pixels, for picking the level of detail.
+	void render(Window * const wnd, const QMatrix4x4 & viewProjection, QSize viewport);
 	void release();
 };
@@ -0,0 +1,237 @@
+#include "Profiler.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+using Event = Profiler::Event;
+using Slot = Profiler::Slot;
+
+struct ThreadBuffer
+{
+	size_t id = 0;
+	std::string name;// guarded by the registry's mutex
+	// Zeroed, so its pages fault in here rather than in the zones.
+	std::unique_ptr<Slot[]> ring = std::make_unique<Slot[]>(Profiler::RING_EVENTS);
+	// Zones ever recorded into the ring, the latest RING_EVENTS of them are still there.
+	std::atomic<size_t> count{0};
+};
+
+// Buffers outlive their threads: the zones of finished workers still get saved,
+// and the next new thread takes over the ring instead of allocating another.
+struct Registry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> threads;
+	std::vector<ThreadBuffer *> retired;
+	// Timestamp and steady_clock at the first zone, for converting timestamps to time.
+	int64_t startTicks = Profiler::now();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+Registry & registry()
+{
+	static Registry instance;
+	return instance;
+}
+
+// Trivially destructible, so still readable while the thread's owner is being destroyed.
+thread_local bool t_exited = false;
+}// namespace
+
+struct Profiler::ThreadOwner
+{
+	ThreadBuffer * buffer = nullptr;
+
+	ThreadOwner() = default;
+	ThreadOwner(const ThreadOwner &) = delete;
+	ThreadOwner & operator=(const ThreadOwner &) = delete;
+
+	~ThreadOwner()
+	{
+		// Zones recorded later in the thread's teardown are dropped.
+		t_exited = true;
+		cursor_ = {};
+		if (buffer != nullptr)
+		{
+			Registry & threads = registry();
+			const std::lock_guard lock{threads.mutex};
+			buffer->name.clear();
+			threads.retired.push_back(buffer);
+		}
+	}
+
+	// The calling thread's buffer, nullptr once the thread is exiting.
+	static ThreadBuffer * get()
+	{
+		if (t_exited)
+		{
+			return nullptr;
+		}
+		ThreadOwner & owner = owner_;
+		if (owner.buffer == nullptr)
+		{
+			Registry & threads = registry();
+			const std::lock_guard lock{threads.mutex};
+			if (threads.retired.empty())
+			{
+				auto & buffer = threads.threads.emplace_back(std::make_unique<ThreadBuffer>());
+				buffer->id = threads.threads.size();
+				owner.buffer = buffer.get();
+			}
+			else
+			{
+				owner.buffer = threads.retired.back();
+				threads.retired.pop_back();
+			}
+		}
+		return owner.buffer;
+	}
+};
+
+thread_local Profiler::ThreadOwner Profiler::owner_;
+
+void Profiler::setEnabled(const bool enabled)
+{
+	enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(std::string name)
+{
+	ThreadBuffer * const buffer = enabled() ? ThreadOwner::get() : nullptr;
+	if (buffer == nullptr)
+	{
+		return;
+	}
+	const std::lock_guard lock{registry().mutex};
+	buffer->name = std::move(name);
+}
+
+void Profiler::recordSlow(const char * const name, const int64_t begin, const int64_t end)
+{
+	// The thread records its first zone, or is exiting.
+	ThreadBuffer * const buffer = ThreadOwner::get();
+	if (buffer == nullptr)
+	{
+		return;
+	}
+	cursor_ = {buffer->ring.get(), &buffer->count, buffer->count.load(std::memory_order_relaxed)};
+	record(name, begin, end);
+}
+
+bool Profiler::save(const QString & path)
+{
+	struct Snapshot
+	{
+		size_t id;
+		std::string name;
+		std::vector<Event> events;
+		size_t overwritten;
+	};
+
+	std::vector<Snapshot> threads;
+	double ticksPerMicrosecond = 1.0e3;
+	{
+		Registry & buffers = registry();
+		const std::lock_guard lock{buffers.mutex};
+#ifdef PROFILER_TSC
+		const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - buffers.start).count();
+		if (elapsed > 0.0)
+		{
+			ticksPerMicrosecond = static_cast<double>(Profiler::now() - buffers.startTicks) / elapsed;
+		}
+#endif
+		for (const auto & buffer : buffers.threads)
+		{
+			const size_t count = buffer->count.load(std::memory_order_acquire);
+			const size_t first = count > RING_EVENTS ? count - RING_EVENTS : 0;
+			Snapshot & snapshot = threads.emplace_back(Snapshot{buffer->id, buffer->name, {}, first});
+			snapshot.events.reserve(count - first);
+			for (size_t i = first; i < count; i++)
+			{
+				const Slot & slot = buffer->ring[i % RING_EVENTS];
+				snapshot.events.push_back({slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed),
+										   slot.end.load(std::memory_order_relaxed)});
+			}
+
+			// The thread may have overwritten slots meanwhile. Any slot it has started on shows in count,
+			// thanks to the fence in record(), so events older than that are dropped.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const size_t after = buffer->count.load(std::memory_order_relaxed);
+			const size_t valid = after >= RING_EVENTS ? after - RING_EVENTS + 1 : 0;
+			if (valid > first)
+			{
+				const size_t stale = std::min(valid, count) - first;
+				snapshot.events.erase(snapshot.events.begin(), snapshot.events.begin() + static_cast<std::ptrdiff_t>(stale));
+				snapshot.overwritten += stale;
+			}
+		}
+	}
+
+	// Microseconds from the first zone.
+	int64_t origin = INT64_MAX;
+	for (const auto & thread : threads)
+	{
+		for (const auto & event : thread.events)
+		{
+			origin = std::min(origin, event.begin);
+		}
+	}
+
+	QJsonArray events;
+	size_t overwritten = 0;
+	for (const auto & thread : threads)
+	{
+		const auto tid = static_cast<qint64>(thread.id);
+		QJsonObject args;
+		args["name"] = QString::fromStdString(thread.name.empty() ? "thread " + std::to_string(thread.id) : thread.name);
+		QJsonObject threadName;
+		threadName["name"] = "thread_name";
+		threadName["ph"] = "M";
+		threadName["pid"] = 1;
+		threadName["tid"] = tid;
+		threadName["args"] = args;
+		events.append(threadName);
+
+		for (const auto & event : thread.events)
+		{
+			QJsonObject zone;
+			zone["name"] = event.name;
+			zone["ph"] = "X";
+			zone["pid"] = 1;
+			zone["tid"] = tid;
+			zone["ts"] = static_cast<double>(event.begin - origin) / ticksPerMicrosecond;
+			zone["dur"] = static_cast<double>(event.end - event.begin) / ticksPerMicrosecond;
+			events.append(zone);
+		}
+		overwritten += thread.overwritten;
+	}
+
+	if (overwritten != 0)
+	{
+		std::cerr << "Trace keeps the latest zones, " << overwritten << " older ones were overwritten" << std::endl;
+	}
+
+	QJsonObject trace;
+	trace["traceEvents"] = events;
+	trace["displayTimeUnit"] = "ms";
+	const QByteArray bytes = QJsonDocument(trace).toJson(QJsonDocument::Compact);
+
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly) || file.write(bytes.constData(), bytes.size()) != bytes.size() || !file.commit())
+	{
+		std::cerr << "Failed to write trace: " << path.toStdString() << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PROFILER_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// CPU zones of every thread, exported in the Chrome trace_event format (chrome://tracing, ui.perfetto.dev).
+// Each thread appends to its own fixed ring without locks, a zone costs two timestamps and an inlined store.
+// Rings keep the latest RING_EVENTS zones, so recording can stay on for as long as the app runs.
+// Off until enabled, a disabled zone is a single relaxed load.
+class Profiler
+{
+public:
+	// Zones kept per thread, older ones get overwritten. About a minute of frames on the render thread.
+	static constexpr size_t RING_EVENTS = size_t{1} << 17;
+
+	static void setEnabled(bool enabled);
+	[[nodiscard]] static bool enabled()
+	{
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	// Shown in the trace for the calling thread. Ignored while disabled.
+	static void setThreadName(std::string name);
+
+	// The latest zones of all threads as trace_event JSON. Recording may go on meanwhile.
+	[[nodiscard]] static bool save(const QString & path);
+
+	// TSC ticks on x86-64, a few times cheaper than steady_clock, which save() calibrates them against.
+	// steady_clock nanoseconds elsewhere.
+	[[nodiscard]] static int64_t now()
+	{
+#ifdef PROFILER_TSC
+		return static_cast<int64_t>(__rdtsc());
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// A finished zone.
+	struct Event
+	{
+		const char * name;
+		int64_t begin;
+		int64_t end;
+	};
+
+	// An Event in a ring. Atomic, since save() may read it while its thread overwrites it.
+	struct Slot
+	{
+		std::atomic<const char *> name;
+		std::atomic<int64_t> begin;
+		std::atomic<int64_t> end;
+	};
+
+	// name must stay valid until the trace is saved, zones use string literals.
+	static void record(const char * const name, const int64_t begin, const int64_t end)
+	{
+		Cursor & cursor = cursor_;
+		if (cursor.ring == nullptr)
+		{
+			recordSlow(name, begin, end);
+			return;
+		}
+		// Orders the overwrite after the count that published the slot's previous event, see save().
+		std::atomic_thread_fence(std::memory_order_release);
+		Slot & slot = cursor.ring[cursor.published % RING_EVENTS];
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.begin.store(begin, std::memory_order_relaxed);
+		slot.end.store(end, std::memory_order_relaxed);
+		// Publishes the event to save().
+		cursor.count->store(++cursor.published, std::memory_order_release);
+	}
+
+private:
+	// The calling thread's ring, zero-initialized like every thread_local,
+	// so empty until the thread's first zone and again once it exits.
+	struct Cursor
+	{
+		Slot * ring;
+		std::atomic<size_t> * count;
+		size_t published;
+	};
+
+	// Hands the thread's ring back for reuse when the thread exits.
+	struct ThreadOwner;
+
+	// Attaches the calling thread to a ring, then records.
+	static void recordSlow(const char * name, int64_t begin, int64_t end);
+
+	inline static std::atomic<bool> enabled_{false};
+	inline static thread_local Cursor cursor_;
+	static thread_local ThreadOwner owner_;
+};
+
+// Records the time from its construction to its destruction as a zone. Zones nest by time.
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char * const name)
+		: name_{Profiler::enabled() ? name : nullptr}
+		, begin_{name_ != nullptr ? Profiler::now() : 0}
+	{
+	}
+
+	~ProfileZone()
+	{
+		if (name_ != nullptr)
+		{
+			Profiler::record(name_, begin_, Profiler::now());
+		}
+	}
+
+	ProfileZone(const ProfileZone &) = delete;
+	ProfileZone & operator=(const ProfileZone &) = delete;
+
+private:
+	const char * name_;
+	int64_t begin_;
+};
@@ -0,0 +1,47 @@
+#include "SamplerCache.h"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+
+GLuint SamplerCache::get(QOpenGLExtraFunctions & gl, const SceneSampler & sampler)
+{
+	const auto cached = std::find_if(samplers_.begin(), samplers_.end(), [&](const auto & entry) { return entry.first == sampler; });
+	if (cached != samplers_.end())
+	{
+		return cached->second;
+	}
+
+	// Core only since GL 4.6, but the extension is everywhere.
+	if (maxAnisotropy_ == 0.0f)
+	{
+		maxAnisotropy_ = 1.0f;
+		if (QOpenGLContext::currentContext()->hasExtension("GL_EXT_texture_filter_anisotropic"))
+		{
+			gl.glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy_);
+		}
+	}
+
+	GLuint id = 0;
+	gl.glGenSamplers(1, &id);
+	gl.glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(sampler.minFilter));
+	gl.glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(sampler.magFilter));
+	gl.glSamplerParameteri(id, GL_TEXTURE_WRAP_S, static_cast<GLint>(sampler.wrapS));
+	gl.glSamplerParameteri(id, GL_TEXTURE_WRAP_T, static_cast<GLint>(sampler.wrapT));
+	if (maxAnisotropy_ > 1.0f)
+	{
+		gl.glSamplerParameterf(id, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::clamp(sampler.anisotropy, 1.0f, maxAnisotropy_));
+	}
+
+	samplers_.emplace_back(sampler, id);
+	return id;
+}
+
+void SamplerCache::destroy(QOpenGLExtraFunctions & gl)
+{
+	for (const auto & [sampler, id] : samplers_)
+	{
+		gl.glDeleteSamplers(1, &id);
+	}
+	samplers_.clear();
+}
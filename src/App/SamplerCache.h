@@ -0,0 +1,22 @@
+#pragma once
+
+#include "SceneLoader.h"
+
+#include <QOpenGLExtraFunctions>
+
+#include <utility>
+#include <vector>
+
+// GL sampler objects, one per distinct SceneSampler, so textures keep no sampling state of their own
+// and one image can be sampled differently by different materials.
+class SamplerCache
+{
+public:
+	// Creates the sampler on first use. Needs the GL context.
+	GLuint get(QOpenGLExtraFunctions & gl, const SceneSampler & sampler);
+	void destroy(QOpenGLExtraFunctions & gl);
+
+private:
+	std::vector<std::pair<SceneSampler, GLuint>> samplers_;
+	float maxAnisotropy_ = 0.0f;// 0: not queried yet, 1: unsupported
+};
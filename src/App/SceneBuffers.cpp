@@ -0,0 +1,154 @@
+#include "SceneBuffers.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+
+void SceneBuffers::create(QOpenGLFunctions & gl, const Scene & scene)
+{
+	allocate(gl, scene);
+	upload(SIZE_MAX);
+}
+
+void SceneBuffers::allocate(QOpenGLFunctions & gl, const Scene & scene)
+{
+	uploads_.clear();
+
+	if (!scene.vertices.empty())
+	{
+		vao_.create();
+		vao_.bind();
+
+		vbo_.create();
+		vbo_.bind();
+		vbo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
+		vbo_.allocate(static_cast<int>(scene.vertices.size() * sizeof(GLfloat)));
+		uploads_.push_back({&vbo_, {reinterpret_cast<const unsigned char *>(scene.vertices.data()), scene.vertices.size() * sizeof(GLfloat)}});
+
+		ibo_.create();
+		ibo_.bind();
+		ibo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
+		ibo_.allocate(static_cast<int>(scene.indexData.size()));
+		uploads_.push_back({&ibo_, scene.indexData});
+
+		geometry_.layout = scene.layout;
+		geometry_.setVertexBytes(scene.vertices.size() * sizeof(GLfloat));
+		geometry_.setAttributeBuffers(gl);
+
+		vao_.release();
+		vbo_.release();
+		ibo_.release();
+	}
+
+	// Each view goes to the GPU once, straight from the glTF buffer.
+	views_.clear();
+	views_.reserve(scene.views.size());// uploads_ points at them
+	for (const auto & view : scene.views)
+	{
+		auto & buffer = views_.emplace_back(view.target == GL_ELEMENT_ARRAY_BUFFER ? QOpenGLBuffer::Type::IndexBuffer
+																				   : QOpenGLBuffer::Type::VertexBuffer);
+		if (view.buffer < 0)
+		{
+			continue;
+		}
+		buffer.create();
+		buffer.bind();
+		buffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+		buffer.allocate(static_cast<int>(view.byteLength));
+		buffer.release();
+		uploads_.push_back({&buffer, scene.buffers[view.buffer].subspan(view.byteOffset, view.byteLength)});
+	}
+
+	viewVaos_.clear();
+	for (const auto & bindings : scene.bindings)
+	{
+		auto & vao = *viewVaos_.emplace_back(std::make_unique<QOpenGLVertexArrayObject>());
+		vao.create();
+		vao.bind();
+		for (const auto & binding : bindings.attributes)
+		{
+			// Not QOpenGLShaderProgram::setAttributeBuffer, it normalizes every integer attribute.
+			const auto & attribute = binding.attribute;
+			views_[binding.view].bind();
+			gl.glEnableVertexAttribArray(attribute.location);
+			gl.glVertexAttribPointer(attribute.location, attribute.tupleSize, attribute.type,
+									 attribute.normalized ? GL_TRUE : GL_FALSE, static_cast<GLsizei>(binding.stride),
+									 reinterpret_cast<const void *>(static_cast<uintptr_t>(attribute.offset)));
+			views_[binding.view].release();
+		}
+		if (bindings.indexView >= 0)
+		{
+			views_[bindings.indexView].bind();
+		}
+		vao.release();
+		if (bindings.indexView >= 0)
+		{
+			views_[bindings.indexView].release();
+		}
+	}
+}
+
+bool SceneBuffers::upload(const size_t maxBytes)
+{
+	const ProfileZone zone("scene.upload");
+
+	// No VAO is bound, binding the index buffers here changes none.
+	size_t budget = maxBytes;
+	while (!uploads_.empty() && budget != 0)
+	{
+		auto & upload = uploads_.front();
+		const size_t count = std::min(upload.bytes.size() - upload.written, budget);
+		if (count != 0)
+		{
+			upload.buffer->bind();
+			upload.buffer->write(static_cast<int>(upload.written), upload.bytes.data() + upload.written, static_cast<int>(count));
+			upload.buffer->release();
+		}
+		upload.written += count;
+		budget -= count;
+		if (upload.written == upload.bytes.size())
+		{
+			uploads_.erase(uploads_.begin());
+		}
+	}
+	return uploads_.empty();
+}
+
+void SceneBuffers::destroy()
+{
+	uploads_.clear();
+	for (auto & vao : viewVaos_)
+	{
+		vao->destroy();
+	}
+	viewVaos_.clear();
+	for (auto & view : views_)
+	{
+		view.destroy();
+	}
+	views_.clear();
+
+	vao_.destroy();
+	vbo_.destroy();
+	ibo_.destroy();
+	bound_ = nullptr;
+}
+
+void SceneBuffers::bind(const DrawRecord & draw)
+{
+	QOpenGLVertexArrayObject * const vao = draw.bindings >= 0 ? viewVaos_[draw.bindings].get() : &vao_;
+	if (vao != bound_)
+	{
+		vao->bind();
+		bound_ = vao;
+	}
+}
+
+void SceneBuffers::release()
+{
+	if (bound_ != nullptr)
+	{
+		bound_->release();
+		bound_ = nullptr;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Geometry.h"
+#include "SceneLoader.h"
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLVertexArrayObject>
+
+#include <memory>
+#include <span>
+#include <vector>
+
+// GPU side of a Scene: the packed vertex and index buffers, every used buffer view uploaded as is,
+// and a VAO per set of view bindings pointing at the original offsets and strides.
+class SceneBuffers
+{
+public:
+	// Uploads the scene, which can be dropped afterwards.
+	void create(QOpenGLFunctions & gl, const Scene & scene);
+	// Creates the buffers and VAOs with undefined contents, upload() fills them in steps.
+	// The scene must stay alive until the upload is done.
+	void allocate(QOpenGLFunctions & gl, const Scene & scene);
+	// Writes up to about maxBytes more of the scene, returns whether everything is uploaded.
+	bool upload(size_t maxBytes);
+	void destroy();
+
+	// Binds the VAO the draw reads from, unless it is bound already.
+	void bind(const DrawRecord & draw);
+	void release();
+
+private:
+	QOpenGLBuffer vbo_{QOpenGLBuffer::Type::VertexBuffer};
+	QOpenGLBuffer ibo_{QOpenGLBuffer::Type::IndexBuffer};
+	QOpenGLVertexArrayObject vao_;
+	Geometry geometry_;
+
+	std::vector<QOpenGLBuffer> views_;// indexed like Scene::views, uncreated if unused
+	std::vector<std::unique_ptr<QOpenGLVertexArrayObject>> viewVaos_;// indexed like Scene::bindings
+
+	QOpenGLVertexArrayObject * bound_ = nullptr;
+
+	// Bytes allocate() left for upload(), written front to back.
+	struct Upload
+	{
+		QOpenGLBuffer * buffer = nullptr;
+		std::span<const unsigned char> bytes;
+		size_t written = 0;
+	};
+	std::vector<Upload> uploads_;
+};
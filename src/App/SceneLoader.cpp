@@ -0,0 +1,557 @@
+#include "SceneLoader.h"
+#include "AccessorReader.h"
+#include "Profiler.h"
+
+#include <QFile>
+#include <QQuaternion>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+constexpr size_t POSITION_OFFSET = 0;
+constexpr size_t NORMAL_OFFSET = 3;
+constexpr size_t TEXCOORD_OFFSET = 6;
+constexpr size_t FLOATS_PER_VERTEX = 8;
+// Primitive restart is off, so 0xFFFF is an ordinary index.
+constexpr size_t MAX_SHORT_INDEXED_VERTICES = 65536;
+
+QMatrix4x4 localTransform(const tinygltf::Node & node)
+{
+	QMatrix4x4 transform;
+	if (node.matrix.size() == 16)
+	{
+		// glTF matrices are column-major, QMatrix4x4 takes rows.
+		float values[16];
+		for (size_t i = 0; i < 16; i++)
+		{
+			values[i] = static_cast<float>(node.matrix[i]);
+		}
+		return QMatrix4x4(values).transposed();
+	}
+
+	if (node.translation.size() == 3)
+	{
+		transform.translate(static_cast<float>(node.translation[0]), static_cast<float>(node.translation[1]),
+							static_cast<float>(node.translation[2]));
+	}
+	if (node.rotation.size() == 4)
+	{
+		transform.rotate(QQuaternion(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]),
+									 static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2])));
+	}
+	if (node.scale.size() == 3)
+	{
+		transform.scale(static_cast<float>(node.scale[0]), static_cast<float>(node.scale[1]),
+						static_cast<float>(node.scale[2]));
+	}
+	return transform;
+}
+
+// Bounds of a POSITION accessor as the shader sees them. Taken from min and max, which glTF requires,
+// and computed from the positions only if a file lacks them.
+void positionBounds(const tinygltf::Model & model, const int index, QVector3D & min, QVector3D & max)
+{
+	const auto & accessor = model.accessors[index];
+	if (accessor.minValues.size() == 3 && accessor.maxValues.size() == 3)
+	{
+		// Min and max are in the stored values, normalized integers still have to be scaled.
+		const auto value = [&](const std::vector<double> & values, const int i) {
+			return AccessorReader::convertValue(values[i], accessor.componentType, accessor.normalized);
+		};
+		min = QVector3D(value(accessor.minValues, 0), value(accessor.minValues, 1), value(accessor.minValues, 2));
+		max = QVector3D(value(accessor.maxValues, 0), value(accessor.maxValues, 1), value(accessor.maxValues, 2));
+		return;
+	}
+
+	std::vector<float> positions(accessor.count * 3);
+	if (positions.empty() || !AccessorReader{model}.readFloats(index, 3, positions.data(), 3))
+	{
+		return;
+	}
+	std::array<float, 3> low{positions[0], positions[1], positions[2]};
+	std::array<float, 3> high = low;
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		low[i % 3] = std::min(low[i % 3], positions[i]);
+		high[i % 3] = std::max(high[i % 3], positions[i]);
+	}
+	min = QVector3D(low[0], low[1], low[2]);
+	max = QVector3D(high[0], high[1], high[2]);
+}
+
+// Leaves images encoded. Embedded ones stay in their buffer view, the others are kept as they are.
+bool deferImage(tinygltf::Image * const image, const int, std::string *, std::string *, const int, const int,
+				const unsigned char * const bytes, const int size, void *)
+{
+	image->as_is = true;
+	if (image->bufferView < 0)
+	{
+		image->image.assign(bytes, bytes + size);
+	}
+	return true;
+}
+
+// The GL can read an accessor in place if it is dense, lies inside its buffer view
+// and its components are aligned to their size.
+bool directAccessor(const tinygltf::Model & model, const int index)
+{
+	if (index < 0 || static_cast<size_t>(index) >= model.accessors.size())
+	{
+		return false;
+	}
+	const auto & accessor = model.accessors[index];
+	if (accessor.sparse.isSparse || accessor.bufferView < 0 || static_cast<size_t>(accessor.bufferView) >= model.bufferViews.size())
+	{
+		return false;
+	}
+	const auto & view = model.bufferViews[accessor.bufferView];
+	if (view.buffer < 0 || static_cast<size_t>(view.buffer) >= model.buffers.size()
+		|| view.byteOffset + view.byteLength > model.buffers[view.buffer].data.size())
+	{
+		return false;
+	}
+
+	const int componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+	const int components = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+	const int stride = accessor.ByteStride(view);
+	if (componentSize <= 0 || components <= 0 || components > 4 || accessor.type == TINYGLTF_TYPE_MAT2 || stride <= 0)
+	{
+		return false;
+	}
+	if (accessor.byteOffset % componentSize != 0 || stride % componentSize != 0)
+	{
+		return false;
+	}
+
+	const size_t elementSize = static_cast<size_t>(componentSize * components);
+	return accessor.count == 0
+		|| accessor.byteOffset + (accessor.count - 1) * static_cast<size_t>(stride) + elementSize <= view.byteLength;
+}
+}// namespace
+
+std::span<const unsigned char> Scene::imageBytes(const size_t image) const
+{
+	const SceneImage & source = images[image];
+	if (source.buffer < 0)
+	{
+		return source.encoded;
+	}
+	return buffers[source.buffer].subspan(source.byteOffset, source.byteLength);
+}
+
+void DrawRecord::draw(QOpenGLExtraFunctions & gl) const
+{
+	if (indexCount != 0)
+	{
+		gl.glDrawElementsBaseVertex(primitive, static_cast<GLsizei>(indexCount), indexType,
+									reinterpret_cast<const void *>(firstIndex * Geometry::typeSize(indexType)), static_cast<GLint>(baseVertex));
+	}
+	else
+	{
+		gl.glDrawArrays(primitive, static_cast<GLint>(baseVertex), static_cast<GLsizei>(vertexCount));
+	}
+}
+
+SceneLoader::SceneLoader(const SceneLoaderSettings & settings)
+	: settings_{settings}
+	, optimizer_{settings.optimizer}
+{
+}
+
+bool SceneLoader::load(const QString & path, Scene & scene, const SceneLayout layout, const SceneImages images)
+{
+	const ProfileZone zone("scene.load");
+
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		std::cerr << "Failed to open gltf: " << path.toStdString() << std::endl;
+		return false;
+	}
+
+	// Parse straight from the mapped file, so tinygltf's buffers are the only copy of the data.
+	// Compressed resources cannot be mapped and are read instead.
+	QByteArray data;
+	const unsigned char * bytes = file.map(0, file.size());
+	size_t size = static_cast<size_t>(file.size());
+	if (bytes == nullptr)
+	{
+		data = file.readAll();
+		bytes = reinterpret_cast<const unsigned char *>(data.constData());
+		size = static_cast<size_t>(data.size());
+	}
+
+	tinygltf::TinyGLTF loader;
+	if (images == SceneImages::Deferred)
+	{
+		loader.SetImageLoader(deferImage, nullptr);
+	}
+	tinygltf::Model model;
+	std::string err, warn;
+	const bool binary = size >= 4 && std::equal(bytes, bytes + 4, "glTF");
+	const bool res = binary
+		? loader.LoadBinaryFromMemory(&model, &err, &warn, bytes, static_cast<unsigned int>(size))
+		: loader.LoadASCIIFromString(&model, &err, &warn, reinterpret_cast<const char *>(bytes), static_cast<unsigned int>(size), "");
+	file.close();
+
+	if (!warn.empty())
+	{
+		std::cerr << "gltf warning: " << path.toStdString() << ": " << warn << std::endl;
+	}
+	if (!res)
+	{
+		std::cerr << "Failed to load gltf: " << path.toStdString() << ": " << err << std::endl;
+		return false;
+	}
+
+	std::cerr << "Loaded gltf: " << path.toStdString() << std::endl;
+	return load(std::move(model), scene, layout);
+}
+
+bool SceneLoader::load(tinygltf::Model model, Scene & scene, const SceneLayout layout)
+{
+	scene = {};
+	scene.layout.add(0, GL_FLOAT, 3).add(1, GL_FLOAT, 3).add(2, GL_FLOAT, 2);
+	assert(scene.layout.stride == FLOATS_PER_VERTEX * sizeof(GLfloat));
+	if (layout == SceneLayout::BufferViews)
+	{
+		scene.views.resize(model.bufferViews.size());
+	}
+	layout_ = layout;
+	statsBefore_ = {};
+	statsAfter_ = {};
+
+	meshRanges_.assign(model.meshes.size(), {});
+	meshLoaded_.assign(model.meshes.size(), false);
+
+	for (const auto & material : model.materials)
+	{
+		const auto & pbr = material.pbrMetallicRoughness;
+		SceneMaterial & out = scene.materials.emplace_back();
+		if (pbr.baseColorFactor.size() == 4)
+		{
+			out.baseColorFactor = QVector4D(static_cast<float>(pbr.baseColorFactor[0]), static_cast<float>(pbr.baseColorFactor[1]),
+											static_cast<float>(pbr.baseColorFactor[2]), static_cast<float>(pbr.baseColorFactor[3]));
+		}
+		if (pbr.baseColorTexture.index >= 0)
+		{
+			const auto & texture = model.textures[pbr.baseColorTexture.index];
+			out.baseColorImage = texture.source;
+			if (texture.sampler >= 0 && static_cast<size_t>(texture.sampler) < model.samplers.size())
+			{
+				const auto & sampler = model.samplers[texture.sampler];
+				SceneSampler & outSampler = out.baseColorSampler;
+				outSampler.minFilter = sampler.minFilter >= 0 ? static_cast<GLenum>(sampler.minFilter) : outSampler.minFilter;
+				outSampler.magFilter = sampler.magFilter >= 0 ? static_cast<GLenum>(sampler.magFilter) : outSampler.magFilter;
+				outSampler.wrapS = static_cast<GLenum>(sampler.wrapS);
+				outSampler.wrapT = static_cast<GLenum>(sampler.wrapT);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < model.scenes.size(); i++)
+	{
+		for (const int node : model.scenes[i].nodes)
+		{
+			addNode(model, node, {}, i, scene);
+		}
+	}
+	scene.defaultScene = model.defaultScene >= 0 ? static_cast<size_t>(model.defaultScene) : 0;
+
+	if (statsBefore_.triangles != 0)
+	{
+		std::cerr << "Optimized " << statsBefore_.triangles << " triangles: ACMR " << statsBefore_.acmr() << " -> "
+				  << statsAfter_.acmr() << ", ATVR " << statsBefore_.atvr() << " -> " << statsAfter_.atvr() << std::endl;
+	}
+
+	// Images tinygltf left encoded.
+	std::vector<int> imageBuffers;
+	if (std::any_of(model.images.begin(), model.images.end(), [](const auto & image) { return image.as_is; }))
+	{
+		for (auto & image : model.images)
+		{
+			SceneImage & out = scene.images.emplace_back();
+			out.mimeType = image.mimeType;
+			if (image.bufferView < 0)
+			{
+				out.encoded = std::move(image.image);
+				continue;
+			}
+
+			const auto & view = model.bufferViews[image.bufferView];
+			if (view.byteOffset + view.byteLength <= model.buffers[view.buffer].data.size())
+			{
+				out.buffer = view.buffer;
+				out.byteOffset = view.byteOffset;
+				out.byteLength = view.byteLength;
+				imageBuffers.push_back(view.buffer);
+			}
+		}
+	}
+
+	// Take over the buffers the draws and images read from.
+	scene.buffers.resize(model.buffers.size());
+	const auto takeOver = [&](const int buffer) {
+		if (buffer >= 0 && scene.buffers[buffer].empty())
+		{
+			auto data = std::make_shared<std::vector<unsigned char>>(std::move(model.buffers[buffer].data));
+			scene.buffers[buffer] = *data;
+			scene.storage.push_back(std::move(data));
+		}
+	};
+	for (const auto & view : scene.views)
+	{
+		takeOver(view.buffer);
+	}
+	for (const int buffer : imageBuffers)
+	{
+		takeOver(buffer);
+	}
+
+	return !scene.draws.empty();
+}
+
+void SceneLoader::addNode(const tinygltf::Model & model, const int node, const QMatrix4x4 & parent,
+						  const size_t sceneIndex, Scene & scene)
+{
+	const auto & gltfNode = model.nodes[node];
+	const QMatrix4x4 world = parent * localTransform(gltfNode);
+
+	if (gltfNode.mesh >= 0)
+	{
+		const auto & primitives = model.meshes[gltfNode.mesh].primitives;
+		const auto & ranges = meshRanges(model, gltfNode.mesh, scene);
+		for (size_t i = 0; i < primitives.size(); i++)
+		{
+			if (!ranges[i].valid)
+			{
+				continue;
+			}
+
+			DrawRecord & record = scene.draws.emplace_back();
+			record.world = world;
+			record.scene = sceneIndex;
+			record.primitive = primitives[i].mode >= 0 ? static_cast<GLenum>(primitives[i].mode) : GL_TRIANGLES;
+			record.baseVertex = ranges[i].baseVertex;
+			record.vertexCount = ranges[i].vertexCount;
+			record.firstIndex = ranges[i].firstIndex;
+			record.indexCount = ranges[i].indexCount;
+			record.indexType = ranges[i].indexType;
+			record.material = primitives[i].material;
+			record.bindings = ranges[i].bindings;
+			record.boundsMin = ranges[i].boundsMin;
+			record.boundsMax = ranges[i].boundsMax;
+		}
+	}
+
+	for (const int child : gltfNode.children)
+	{
+		addNode(model, child, world, sceneIndex, scene);
+	}
+}
+
+auto SceneLoader::meshRanges(const tinygltf::Model & model, const int mesh, Scene & scene) -> const std::vector<PrimitiveRange> &
+{
+	auto & ranges = meshRanges_[mesh];
+	if (!meshLoaded_[mesh])
+	{
+		for (const auto & primitive : model.meshes[mesh].primitives)
+		{
+			PrimitiveRange & range = ranges.emplace_back(addPrimitive(model, primitive, scene));
+			if (range.valid)
+			{
+				positionBounds(model, primitive.attributes.at("POSITION"), range.boundsMin, range.boundsMax);
+			}
+		}
+		meshLoaded_[mesh] = true;
+	}
+	return ranges;
+}
+
+auto SceneLoader::addPrimitive(const tinygltf::Model & model, const tinygltf::Primitive & primitive, Scene & scene) -> PrimitiveRange
+{
+	const auto position = primitive.attributes.find("POSITION");
+	if (position == primitive.attributes.end())
+	{
+		return {};
+	}
+
+	if (layout_ == SceneLayout::BufferViews)
+	{
+		const PrimitiveRange range = addViewPrimitive(model, primitive, scene);
+		if (range.valid)
+		{
+			return range;
+		}
+	}
+
+	const AccessorReader reader{model};
+	PrimitiveRange range;
+	range.baseVertex = scene.vertices.size() / FLOATS_PER_VERTEX;
+	range.vertexCount = reader.count(position->second);
+	const size_t indexEnd = scene.indexData.size();
+
+	scene.vertices.resize(scene.vertices.size() + range.vertexCount * FLOATS_PER_VERTEX, 0.0f);
+	GLfloat * const vertices = scene.vertices.data() + range.baseVertex * FLOATS_PER_VERTEX;
+
+	// Every attribute has to describe the same vertices as POSITION.
+	const auto read = [&](const char * const name, const int components, const size_t offset) {
+		const auto attribute = primitive.attributes.find(name);
+		return attribute == primitive.attributes.end()
+			|| (reader.count(attribute->second) == range.vertexCount
+				&& reader.readFloats(attribute->second, components, vertices + offset, FLOATS_PER_VERTEX));
+	};
+
+	bool ok = read("POSITION", 3, POSITION_OFFSET) && read("NORMAL", 3, NORMAL_OFFSET) && read("TEXCOORD_0", 2, TEXCOORD_OFFSET);
+	if (ok && primitive.indices >= 0)
+	{
+		// Indices are relative to the base vertex, so the primitive's own vertex count decides their width.
+		range.indexType = range.vertexCount <= MAX_SHORT_INDEXED_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		const size_t size = Geometry::typeSize(range.indexType);
+		range.firstIndex = (indexEnd + size - 1) / size;
+		range.indexCount = reader.count(primitive.indices);
+		scene.indexData.resize((range.firstIndex + range.indexCount) * size);
+		unsigned char * const indices = scene.indexData.data() + range.firstIndex * size;
+		const bool triangles = primitive.mode < 0 || primitive.mode == TINYGLTF_MODE_TRIANGLES;
+		if (settings_.optimizeMeshes && triangles)
+		{
+			// Reordered as 32 bit, then narrowed. Like the unoptimized path, indices that are out of range
+			// or do not fit the type fail the primitive.
+			std::vector<uint32_t> optimized(range.indexCount);
+			const auto fitsShort = [](const uint32_t index) {
+				return index <= std::numeric_limits<uint16_t>::max();
+			};
+			ok = reader.readIndices(primitive.indices, optimized.data())
+				&& optimize(optimized, {vertices, range.vertexCount * FLOATS_PER_VERTEX})
+				&& (range.indexType != GL_UNSIGNED_SHORT || std::all_of(optimized.begin(), optimized.end(), fitsShort));
+			if (ok && range.indexType == GL_UNSIGNED_SHORT)
+			{
+				std::copy(optimized.begin(), optimized.end(), reinterpret_cast<uint16_t *>(indices));
+			}
+			else if (ok)
+			{
+				std::copy(optimized.begin(), optimized.end(), reinterpret_cast<uint32_t *>(indices));
+			}
+		}
+		else
+		{
+			ok = range.indexType == GL_UNSIGNED_SHORT ? reader.readIndices(primitive.indices, reinterpret_cast<uint16_t *>(indices))
+													  : reader.readIndices(primitive.indices, reinterpret_cast<uint32_t *>(indices));
+		}
+	}
+
+	if (!ok)
+	{
+		// Drop whatever this primitive appended.
+		scene.vertices.resize(range.baseVertex * FLOATS_PER_VERTEX);
+		scene.indexData.resize(indexEnd);
+		return {};
+	}
+
+	range.valid = true;
+	return range;
+}
+
+bool SceneLoader::optimize(const std::span<uint32_t> indices, const std::span<GLfloat> vertices)
+{
+	const size_t vertexCount = vertices.size() / FLOATS_PER_VERTEX;
+	const VertexCacheStats before = optimizer_.analyze(indices, vertexCount);
+	if (!optimizer_.optimize(indices, vertices, FLOATS_PER_VERTEX))
+	{
+		std::cerr << "Primitive has invalid indices" << std::endl;
+		return false;
+	}
+	statsBefore_ += before;
+	statsAfter_ += optimizer_.analyze(indices, vertexCount);
+	return true;
+}
+
+auto SceneLoader::addViewPrimitive(const tinygltf::Model & model, const tinygltf::Primitive & primitive, Scene & scene) -> PrimitiveRange
+{
+	const int position = primitive.attributes.at("POSITION");
+	if (!directAccessor(model, position))
+	{
+		return {};
+	}
+
+	PrimitiveRange range;
+	range.vertexCount = model.accessors[position].count;
+
+	// Views are only marked once the whole primitive is known to be readable in place.
+	// A view is bound to a single target, as vertex or as index data.
+	ViewBindings bindings;
+	std::vector<std::pair<int, GLenum>> uses;
+	const auto use = [&](const int view, const GLenum target) {
+		const bool conflict = (scene.views[view].buffer >= 0 && scene.views[view].target != target)
+			|| std::any_of(uses.begin(), uses.end(), [&](const auto & other) { return other.first == view && other.second != target; });
+		uses.emplace_back(view, target);
+		return !conflict;
+	};
+	const auto bind = [&](const char * const name, const GLuint location) {
+		const auto attribute = primitive.attributes.find(name);
+		if (attribute == primitive.attributes.end())
+		{
+			return true;
+		}
+		if (!directAccessor(model, attribute->second) || model.accessors[attribute->second].count != range.vertexCount)
+		{
+			return false;
+		}
+
+		const auto & accessor = model.accessors[attribute->second];
+		ViewAttribute & out = bindings.attributes.emplace_back();
+		out.attribute.location = location;
+		out.attribute.type = static_cast<GLenum>(accessor.componentType);
+		out.attribute.tupleSize = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+		out.attribute.offset = accessor.byteOffset;
+		out.attribute.normalized = accessor.normalized;
+		out.view = accessor.bufferView;
+		out.stride = model.bufferViews[accessor.bufferView].byteStride;
+		return use(accessor.bufferView, GL_ARRAY_BUFFER);
+	};
+	if (!bind("POSITION", 0) || !bind("NORMAL", 1) || !bind("TEXCOORD_0", 2))
+	{
+		return {};
+	}
+
+	if (primitive.indices >= 0)
+	{
+		if (!directAccessor(model, primitive.indices))
+		{
+			return {};
+		}
+		const auto & accessor = model.accessors[primitive.indices];
+		const auto type = static_cast<GLenum>(accessor.componentType);
+		const auto & view = model.bufferViews[accessor.bufferView];
+		if (accessor.type != TINYGLTF_TYPE_SCALAR || (type != GL_UNSIGNED_BYTE && type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT)
+			|| view.byteStride > Geometry::typeSize(type))
+		{
+			return {};
+		}
+
+		range.firstIndex = accessor.byteOffset / Geometry::typeSize(type);
+		range.indexCount = accessor.count;
+		range.indexType = type;
+		bindings.indexView = accessor.bufferView;
+		if (!use(accessor.bufferView, GL_ELEMENT_ARRAY_BUFFER))
+		{
+			return {};
+		}
+	}
+
+	for (const auto & [view, target] : uses)
+	{
+		const auto & gltfView = model.bufferViews[view];
+		scene.views[view] = {gltfView.buffer, gltfView.byteOffset, gltfView.byteLength, target};
+	}
+
+	range.bindings = static_cast<int>(scene.bindings.size());
+	scene.bindings.push_back(std::move(bindings));
+	range.valid = true;
+	return range;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "Geometry.h"
+#include "MeshOptimizer.h"
+
+#include <QMatrix4x4>
+#include <QOpenGLExtraFunctions>
+#include <QString>
+#include <QVector3D>
+#include <QVector4D>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// How SceneLoader hands primitives to the GPU.
+enum class SceneLayout
+{
+	Interleaved,// repacked into Scene::vertices and Scene::indices
+	BufferViews,// glTF buffer views uploaded as is, primitives that cannot be read in place are repacked
+};
+
+// Who decodes the images of a scene.
+enum class SceneImages
+{
+	Decoded,// tinygltf, while loading, into pixels nothing else uses
+	Deferred,// the renderer, from the encoded bytes in Scene::images
+};
+
+// How a material samples its texture. Filters and wrap modes come from the glTF sampler,
+// the renderer picks the anisotropy. Unset glTF filters default to trilinear.
+struct SceneSampler
+{
+	GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLenum magFilter = GL_LINEAR;
+	GLenum wrapS = GL_REPEAT;
+	GLenum wrapT = GL_REPEAT;
+	float anisotropy = 1.0f;// 1: off, clamped to what the driver supports
+
+	bool operator==(const SceneSampler &) const = default;
+};
+
+// What a renderer needs from a glTF material. Textures refer to glTF image indices.
+struct SceneMaterial
+{
+	QVector4D baseColorFactor{1, 1, 1, 1};
+	int baseColorImage = -1;
+	SceneSampler baseColorSampler;
+};
+
+// One primitive placed by one node. Ranges refer to the shared vertex and index data of its Scene.
+struct DrawRecord
+{
+	QMatrix4x4 world;// flattened node transform
+	size_t scene = 0;
+	GLenum primitive = GL_TRIANGLES;
+	size_t baseVertex = 0;
+	size_t vertexCount = 0;
+	size_t firstIndex = 0;// in indexType elements
+	size_t indexCount = 0;// 0 for non-indexed primitives
+	GLenum indexType = GL_UNSIGNED_INT;
+	int material = -1;
+	int bindings = -1;// index into Scene::bindings, -1: packed vertices and indices
+	QVector3D boundsMin;// of the primitive's positions, before world
+	QVector3D boundsMax;
+
+	// Draws with the scene's VAO bound.
+	void draw(QOpenGLExtraFunctions & gl) const;
+};
+
+// Encoded bytes of a glTF image, a range of Scene::buffers for embedded images.
+struct SceneImage
+{
+	std::string mimeType;
+	int buffer = -1;// -1: the bytes are in encoded
+	size_t byteOffset = 0;
+	size_t byteLength = 0;
+	std::vector<unsigned char> encoded;
+};
+
+// Byte range of a glTF buffer view the draws read from.
+struct SceneView
+{
+	int buffer = -1;// -1: not used by any draw
+	size_t byteOffset = 0;
+	size_t byteLength = 0;
+	GLenum target = GL_ARRAY_BUFFER;
+};
+
+// A vertex attribute read in place from a buffer view, offset is the accessor's offset inside the view.
+struct ViewAttribute
+{
+	VertexAttribute attribute;
+	int view = -1;
+	size_t stride = 0;// 0: tightly packed
+};
+
+// Where a primitive loaded with SceneLayout::BufferViews reads from, missing attributes are left out.
+struct ViewBindings
+{
+	std::vector<ViewAttribute> attributes;
+	int indexView = -1;
+};
+
+// Every primitive of every scene. Packed primitives share buffers with one vertex layout,
+// so they are all drawn from a single VAO.
+struct Scene
+{
+	// pos (location=0), norm (location=1), tex (location=2), missing attributes are zero
+	VertexLayout layout;
+	std::vector<GLfloat> vertices;
+	// Indices local to the primitive, drawn with its baseVertex. 16 bit wherever the primitive has
+	// at most 65536 vertices, each range aligned to its DrawRecord::indexType.
+	std::vector<unsigned char> indexData;
+
+	// SceneLayout::BufferViews and cooked scenes: the bytes of the buffers, kept alive by storage,
+	// and the views the draws read from, indexed like the model's bufferViews.
+	std::vector<std::span<const unsigned char>> buffers;
+	std::vector<std::shared_ptr<const void>> storage;
+	std::vector<SceneView> views;
+	std::vector<ViewBindings> bindings;
+
+	// Indexed like the model's images, empty unless loaded with SceneImages::Deferred.
+	std::vector<SceneImage> images;
+
+	std::vector<SceneMaterial> materials;
+	std::vector<DrawRecord> draws;
+	size_t defaultScene = 0;
+
+	// Encoded bytes of an image, empty if it could not be loaded.
+	[[nodiscard]] std::span<const unsigned char> imageBytes(size_t image) const;
+};
+
+struct SceneLoaderSettings
+{
+	// Reorders repacked triangle lists for the vertex cache, overdraw and vertex fetch, and reports
+	// their ACMR/ATVR before and after. Buffer views uploaded as is keep the authored order.
+	bool optimizeMeshes = false;
+	MeshOptimizerSettings optimizer;
+};
+
+class SceneLoader
+{
+public:
+	explicit SceneLoader(const SceneLoaderSettings & settings = {});
+
+	// Loads a .glb or a self-contained .gltf from a file or Qt resource path.
+	[[nodiscard]] bool load(const QString & path, Scene & scene, SceneLayout layout = SceneLayout::Interleaved,
+							SceneImages images = SceneImages::Decoded);
+	// The scene takes over the buffers of the model its views and deferred images refer to.
+	[[nodiscard]] bool load(tinygltf::Model model, Scene & scene, SceneLayout layout = SceneLayout::Interleaved);
+
+private:
+	// Ranges of a mesh's primitives, appended once however many nodes place the mesh.
+	struct PrimitiveRange
+	{
+		bool valid = false;
+		size_t baseVertex = 0;
+		size_t vertexCount = 0;
+		size_t firstIndex = 0;
+		size_t indexCount = 0;
+		GLenum indexType = GL_UNSIGNED_INT;
+		int bindings = -1;
+		QVector3D boundsMin;
+		QVector3D boundsMax;
+	};
+
+	void addNode(const tinygltf::Model & model, int node, const QMatrix4x4 & parent, size_t sceneIndex, Scene & scene);
+	const std::vector<PrimitiveRange> & meshRanges(const tinygltf::Model & model, int mesh, Scene & scene);
+	PrimitiveRange addPrimitive(const tinygltf::Model & model, const tinygltf::Primitive & primitive, Scene & scene);
+	PrimitiveRange addViewPrimitive(const tinygltf::Model & model, const tinygltf::Primitive & primitive, Scene & scene);
+
+	// Reorders one primitive's triangles and vertices and counts the statistics. False for invalid indices.
+	bool optimize(std::span<uint32_t> indices, std::span<GLfloat> vertices);
+
+	SceneLoaderSettings settings_;
+	MeshOptimizer optimizer_;
+	VertexCacheStats statsBefore_;
+	VertexCacheStats statsAfter_;
+
+	SceneLayout layout_ = SceneLayout::Interleaved;
+	std::vector<std::vector<PrimitiveRange>> meshRanges_;
+	std::vector<bool> meshLoaded_;
+};
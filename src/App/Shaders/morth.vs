@@ -1,9 +1,252 @@
 #version 330 core
 
+#ifdef MORTH_PROCEDURAL
+// Both endpoints are rebuilt from the vertex id, mirroring MorphMeshGenerator:
+// top cap (pole first), body (top to bottom), bottom cap (pole first).
+uniform int resolution;
+
+const float PI = 3.14159265358979323846;
+const float SPHERE_SCALE = 1.7320508075688772;
+
+// Cap ring i starts at 4 i^2, the estimate from sqrt is fixed up for rounding.
+int capRing(int id)
+{
+  int i = int(sqrt(float(id) / 4.0));
+  while (4 * (i + 1) * (i + 1) <= id) {
+    i++;
+  }
+  while (4 * i * i > id) {
+    i--;
+  }
+  return i;
+}
+
+void cubeCap(float phi, float c, float s, float side, out vec3 pos, out vec3 norm)
+{
+  float t = tan(phi) * side / max(abs(c), abs(s));
+  pos = vec3(t * c, side, t * s);
+  norm = vec3(0, side, 0);
+}
+
+// Walks the cube perimeter from corner (1, -1), the ring starts N steps into the first side.
+void cubeBody(int j, float y, out vec3 pos, out vec3 norm)
+{
+  const vec2 sideNormals[4] = vec2[4](vec2(1, 0), vec2(0, 1), vec2(-1, 0), vec2(0, -1));
+
+  int edge = 2 * resolution - 1;
+  float dd = 2.0 / float(edge);
+  int steps = j + resolution;
+  int side = (steps / edge) % 4;
+  int step = steps % edge;
+  float local = float(step) * dd;
+
+  vec2 xz;
+  if (side == 0) {
+    xz = vec2(1, -1 + local);
+  } else if (side == 1) {
+    xz = vec2(1 - local, 1);
+  } else if (side == 2) {
+    xz = vec2(-1, 1 - local);
+  } else {
+    xz = vec2(-1 + local, -1);
+  }
+
+  vec2 n = sideNormals[side];
+  if (step == 0) {
+    n += sideNormals[(side + 3) % 4];
+  }
+
+  pos = vec3(xz.x, y, xz.y);
+  norm = vec3(n.x, 0, n.y);
+}
+
+// Triangles are rebuilt too, mirroring MorphTopology::vertex: gl_VertexID counts triangle corners.
+int ringSize(int ring)
+{
+  int n = resolution;
+  if (ring < n) {
+    return 8 * ring + 4;
+  }
+  if (ring < 3 * n - 2) {
+    return 8 * n - 4;
+  }
+  return 8 * (ring - (3 * n - 2)) + 4;
+}
+
+int ringOffset(int ring)
+{
+  int n = resolution;
+  if (ring < n) {
+    return 4 * ring * ring;
+  }
+  if (ring < 3 * n - 2) {
+    return 4 * n * n + (ring - n) * (8 * n - 4);
+  }
+  int i = ring - (3 * n - 2);
+  return 4 * n * n + (2 * n - 2) * (8 * n - 4) + 4 * i * i;
+}
+
+// The bottom cap is stored pole first, so walk it backwards.
+int latitudeRing(int latitude)
+{
+  int bottom = 3 * resolution - 2;
+  return latitude < bottom ? latitude : bottom + (4 * resolution - 3 - latitude);
+}
+
+// Points on the latitudes above latitude.
+int latitudeOffset(int latitude)
+{
+  int n = resolution;
+  if (latitude <= 3 * n - 2) {
+    return ringOffset(latitude);
+  }
+  int below = 4 * n - 2 - latitude;
+  return 24 * n * n - 24 * n + 8 - 4 * below * below;
+}
+
+// First triangle of the band between latitude and latitude + 1.
+int bandOffset(int latitude)
+{
+  return 2 + latitudeOffset(latitude) + latitudeOffset(latitude + 1) - 4;
+}
+
+// Position of upper step a among the band's steps.
+int upperPosition(int a, int nu, int nl)
+{
+  int key = (2 * a + 3) * nl;
+  return a + (key <= 3 * nu ? 0 : min((key - 1 - 3 * nu) / (2 * nu) + 1, nl));
+}
+
+int topologyVertex(int corner)
+{
+  int n = resolution;
+  int triangle = corner / 3;
+  int k = corner % 3;
+  int rings = 4 * n - 2;
+  int triangles = 2 * (24 * n * n - 24 * n + 8) - 4;
+
+  if (triangle < 2 || triangle >= triangles - 2) {
+    bool isNorth = triangle < 2;
+    int pole = ringOffset(latitudeRing(isNorth ? 0 : rings - 1));
+    ivec3 fan = triangle % 2 == 0 ? (isNorth ? ivec3(0, 2, 1) : ivec3(0, 1, 2))
+                                  : (isNorth ? ivec3(0, 3, 2) : ivec3(0, 2, 3));
+    return pole + fan[k];
+  }
+
+  int low = 0;
+  int high = rings - 2;
+  while (low < high) {
+    int middle = (low + high + 1) / 2;
+    if (bandOffset(middle) <= triangle) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  int upperRing = latitudeRing(low);
+  int lowerRing = latitudeRing(low + 1);
+  int upper = ringOffset(upperRing);
+  int lower = ringOffset(lowerRing);
+  int nu = ringSize(upperRing);
+  int nl = ringSize(lowerRing);
+  int step = triangle - bandOffset(low);
+
+  int a = 0;
+  high = nu;
+  while (a < high) {
+    int middle = (a + high) / 2;
+    if (upperPosition(middle, nu, nl) < step) {
+      a = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  int b = step - a;
+  ivec3 corners = a < nu && upperPosition(a, nu, nl) == step
+    ? ivec3(upper + a, upper + (a + 1) % nu, lower + b % nl)
+    : ivec3(upper + a % nu, lower + (b + 1) % nl, lower + b);
+  return corners[k];
+}
+
+void endpoints(int id, out vec3 p1, out vec3 n1, out vec3 p2, out vec3 n2)
+{
+  int n = resolution;
+  int capSize = 4 * n * n;
+  int bodyDots = 8 * n - 4;
+  int bodySize = (2 * n - 2) * bodyDots;
+  float deltaPhi = PI / float(4 * n - 2);
+
+  int latitude;
+  int j;
+  int dots;
+  float phi;
+  if (id < capSize) {
+    latitude = capRing(id);
+    j = id - 4 * latitude * latitude;
+    dots = 8 * latitude + 4;
+    phi = deltaPhi * (float(latitude) + 0.5);
+  } else if (id < capSize + bodySize) {
+    latitude = (id - capSize) / bodyDots;
+    j = id - capSize - latitude * bodyDots;
+    dots = bodyDots;
+    phi = deltaPhi * (float(n + latitude) + 0.5);
+  } else {
+    int local = id - capSize - bodySize;
+    latitude = capRing(local);
+    j = local - 4 * latitude * latitude;
+    dots = 8 * latitude + 4;
+    phi = PI - deltaPhi * (float(latitude) + 0.5);
+  }
+
+  float theta = 2.0 * PI * (float(j) + 0.5) / float(dots);
+  float c = cos(theta);
+  float s = sin(theta);
+  p1 = vec3(sin(phi) * c, cos(phi), sin(phi) * s) * SPHERE_SCALE;
+  n1 = p1;
+
+  if (id < capSize) {
+    cubeCap(phi, c, s, 1.0, p2, n2);
+  } else if (id < capSize + bodySize) {
+    cubeBody(j, 1.0 - 2.0 / float(2 * n - 1) * float(latitude + 1), p2, n2);
+  } else {
+    cubeCap(phi, c, s, -1.0, p2, n2);
+  }
+}
+#elif defined(MORTH_PACKED)
+// Raw int16 values: positions scaled by 32767 / bound, octahedral normals by 32767.
+layout(location=0) in vec3 packedPos1;
+layout(location=1) in vec2 packedNorm1;
+layout(location=2) in vec3 packedPos2;
+layout(location=3) in vec2 packedNorm2;
+
+uniform float positionScale;
+
+vec3 decodeOctahedral(vec2 e)
+{
+  e /= 32767.0;
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+#elif defined(MORTH_TARGETS)
+// Base shape per vertex, the other targets as deltas from it:
+// two RGBA32F texels (position, normal) per target and vertex, starting at deltaOffset.
+layout(location=0) in vec3 basePos;
+layout(location=1) in vec3 baseNorm;
+
+uniform samplerBuffer targetDeltas;
+uniform int targetCount;
+uniform int deltaOffset;
+uniform int vertexCount;
+uniform float weights[8];// summing to 1, weights[0] is the base
+#else
 layout(location=0) in vec3 pos1;
 layout(location=1) in vec3 norm1;
 layout(location=2) in vec3 pos2;
 layout(location=3) in vec3 norm2;
+#endif
 
 uniform mat4 mvp;
 uniform float time;
@@ -14,6 +257,17 @@ uniform bool enableManual;
 out vec3 vert_col;
 
 void main() {
+#ifdef MORTH_TARGETS
+  vec3 pos = basePos;
+  vec3 norm = baseNorm;
+  for (int k = 1; k < targetCount; k++) {
+    if (weights[k] != 0.0) {
+      int texel = deltaOffset + 2 * ((k - 1) * vertexCount + gl_VertexID);
+      pos += weights[k] * texelFetch(targetDeltas, texel).xyz;
+      norm += weights[k] * texelFetch(targetDeltas, texel + 1).xyz;
+    }
+  }
+#else
   float ik;
 
   if (enableManual) {
@@ -22,8 +276,19 @@ void main() {
     ik = 0.5 + tan(time * 3);
   }
 
+#ifdef MORTH_PROCEDURAL
+  vec3 pos1, norm1, pos2, norm2;
+  endpoints(topologyVertex(gl_VertexID), pos1, norm1, pos2, norm2);
+#elif defined(MORTH_PACKED)
+  vec3 pos1 = packedPos1 * positionScale;
+  vec3 norm1 = decodeOctahedral(packedNorm1);
+  vec3 pos2 = packedPos2 * positionScale;
+  vec3 norm2 = decodeOctahedral(packedNorm2);
+#endif
+
   vec3 pos = mix(pos1, pos2, ik);
   vec3 norm = mix(norm1, norm2, ik);
+#endif
 	gl_Position = mvp * vec4(pos, 1);
   vert_col = abs(normalize(norm));
 }
@@ -0,0 +1,57 @@
+// Compares every MorphKernels variant the CPU supports against the scalar reference.
+
+#include "MorphKernels.h"
+#include "MorphMeshGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+constexpr float PI = 3.14159265358979323846f;
+
+float maxDeviation(const std::vector<MorphVertex> & expected, const std::vector<MorphVertex> & actual)
+{
+	float deviation = 0;
+	const auto * e = &expected[0].pos1[0];
+	const auto * a = &actual[0].pos1[0];
+	for (size_t i = 0; i < expected.size() * sizeof(MorphVertex) / sizeof(float); i++)
+	{
+		deviation = std::max(deviation, std::abs(e[i] - a[i]) / std::max(1.0f, std::abs(e[i])));
+	}
+	return deviation;
+}
+}// namespace
+
+int main()
+{
+	const MorphKernels & scalar = MorphKernels::scalar();
+	bool ok = true;
+	for (const MorphKernels * const kernels : MorphKernels::supported())
+	{
+		float worst = 0;
+		// Counts cover full vector blocks, scalar tails and rings shorter than one block.
+		for (const size_t count : {1, 3, 4, 7, 8, 9, 8 * 17 + 4, 4 * 2000 + 3})
+		{
+			std::vector<MorphVertex> expected(count), actual(count);
+			for (const float phi : {0.05f, 0.7f, 1.5f, 2.4f, 3.1f})
+			{
+				const float side = phi < PI / 2 ? 1.0f : -1.0f;
+				scalar.capRing(phi, side, count, expected.data());
+				kernels->capRing(phi, side, count, actual.data());
+				worst = std::max(worst, maxDeviation(expected, actual));
+
+				scalar.sphereRing(phi, count, expected.data());
+				kernels->sphereRing(phi, count, actual.data());
+				worst = std::max(worst, maxDeviation(expected, actual));
+			}
+		}
+
+		const bool passed = worst <= MorphKernels::TOLERANCE;
+		std::cout << kernels->name << ": max deviation " << worst << (passed ? " ok" : " FAILED") << std::endl;
+		ok = ok && passed;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+// Compares the closed-form MorphTopology::vertex, which morth.vs mirrors, against the built index list.
+
+#include "MorphTopology.h"
+
+#include <iostream>
+#include <vector>
+
+int main()
+{
+	bool ok = true;
+	// Resolution 1 has no body rings, the larger ones zip rings of very different sizes.
+	for (const size_t resolution : {1, 2, 3, 5, 8, 17, 64})
+	{
+		const MorphMeshGenerator generator{resolution};
+		const MorphTopology topology{generator};
+		std::vector<uint32_t> indices(topology.indexCount());
+		topology.build(indices.data());
+
+		size_t mismatches = 0;
+		for (size_t corner = 0; corner < indices.size(); corner++)
+		{
+			mismatches += topology.vertex(corner) != indices[corner] ? 1 : 0;
+		}
+
+		const bool passed = mismatches == 0;
+		std::cout << "resolution " << resolution << ": " << mismatches << " mismatched corners" << (passed ? " ok" : " FAILED")
+				  << std::endl;
+		ok = ok && passed;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// Times enter and exit of an enabled ProfileZone against the 50 ns budget that keeps zones on in production.
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+constexpr double BUDGET_NANOSECONDS = 50.0;
+// Left for the zone's own bookkeeping, hosts whose timestamps leave less can't judge the zone.
+constexpr double BOOKKEEPING_NANOSECONDS = 10.0;
+constexpr int ZONES = 10000;
+constexpr int BATCHES = 100;
+// ctest's SKIP_RETURN_CODE.
+constexpr int SKIPPED = 77;
+
+// Short batches, so the best of them is one no preemption landed in.
+template<typename Body>
+double nanosecondsPer(const Body & body)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < ZONES; i++)
+	{
+		body(i);
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ZONES;
+}
+}// namespace
+
+int main()
+{
+	// Two timestamps and a store, with no bookkeeping, as the baseline the host allows.
+	std::vector<Profiler::Event> events(ZONES);
+	const auto bareZone = [&events](const int i) {
+		const int64_t begin = Profiler::now();
+		events[i] = {"benchmark.bare", begin, Profiler::now()};
+	};
+	const auto profiledZone = [](int) {
+		const ProfileZone zone("benchmark.zone");
+	};
+
+	// Best of interleaved batches, so preemption and timer hiccups hit both alike.
+	double baseline = 1.0e9;
+	double enabled = 1.0e9;
+	double disabled = 1.0e9;
+	Profiler::setThreadName("benchmark");
+	for (int batch = 0; batch < BATCHES; batch++)
+	{
+		baseline = std::min(baseline, nanosecondsPer(bareZone));
+		Profiler::setEnabled(true);
+		enabled = std::min(enabled, nanosecondsPer(profiledZone));
+		Profiler::setEnabled(false);
+		disabled = std::min(disabled, nanosecondsPer(profiledZone));
+	}
+
+	std::cout << "Zone enter+exit: " << enabled << " ns enabled, " << disabled << " ns disabled, "
+			  << baseline << " ns for two bare timestamps and a store" << std::endl;
+	if (enabled <= BUDGET_NANOSECONDS)
+	{
+		return 0;
+	}
+	if (enabled - baseline > BOOKKEEPING_NANOSECONDS)
+	{
+		std::cerr << "Zones take over " << BUDGET_NANOSECONDS << " ns" << std::endl;
+		return 1;
+	}
+	// Virtualized or throttled timers, the zone itself can't be judged here.
+	std::cerr << "Timestamps alone take over " << BUDGET_NANOSECONDS - BOOKKEEPING_NANOSECONDS << " ns on this host, skipped" << std::endl;
+	return SKIPPED;
+}
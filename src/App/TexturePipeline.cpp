@@ -0,0 +1,248 @@
+#include "TexturePipeline.h"
+#include "Profiler.h"
+
+#include <tinygltf/stb_image.h>
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_PIPELINE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+constexpr size_t CHANNELS = 4;
+
+size_t levelCount(const size_t width, const size_t height)
+{
+	size_t levels = 1;
+	for (size_t size = std::max(width, height); size > 1; size /= 2)
+	{
+		levels++;
+	}
+	return levels;
+}
+
+size_t levelSize(const size_t size, const size_t level)
+{
+	return std::max<size_t>(size >> level, 1);
+}
+
+// 2x2 box filter of one RGBA8 row pair. Odd sizes drop the last source column, a 1 wide level repeats it.
+void downsampleRow(const unsigned char * const row0, const unsigned char * const row1, const size_t srcWidth,
+				   unsigned char * const out, const size_t width)
+{
+	size_t x = 0;
+#ifdef TEXTURE_PIPELINE_SSE2
+	// Four source pixels of both rows make two output pixels.
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rounding = _mm_set1_epi16(2);
+	for (; x + 2 <= width; x += 2)
+	{
+		const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 2 * x * CHANNELS));
+		const __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 2 * x * CHANNELS));
+		const __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+		const __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+		const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(left, right), _mm_unpackhi_epi64(left, right));
+		const __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(out + x * CHANNELS), _mm_packus_epi16(average, zero));
+	}
+#endif
+	for (; x < width; x++)
+	{
+		const size_t x0 = 2 * x;
+		const size_t x1 = std::min(x0 + 1, srcWidth - 1);
+		for (size_t c = 0; c < CHANNELS; c++)
+		{
+			const unsigned sum = row0[x0 * CHANNELS + c] + row0[x1 * CHANNELS + c] + row1[x0 * CHANNELS + c] + row1[x1 * CHANNELS + c];
+			out[x * CHANNELS + c] = static_cast<unsigned char>((sum + 2) / 4);
+		}
+	}
+}
+
+void downsample(const unsigned char * const src, const size_t srcWidth, const size_t srcHeight, unsigned char * const out)
+{
+	const size_t width = levelSize(srcWidth, 1);
+	const size_t height = levelSize(srcHeight, 1);
+	const size_t rowBytes = srcWidth * CHANNELS;
+	for (size_t y = 0; y < height; y++)
+	{
+		const size_t y0 = 2 * y;
+		const size_t y1 = std::min(y0 + 1, srcHeight - 1);
+		downsampleRow(src + y0 * rowBytes, src + y1 * rowBytes, srcWidth, out + y * width * CHANNELS, width);
+	}
+}
+}// namespace
+
+TexturePipeline::TexturePipeline(const size_t threadCount)
+	: threadCount_{threadCount != 0 ? threadCount : std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1}
+{
+}
+
+TexturePipeline::~TexturePipeline()
+{
+	{
+		const std::lock_guard lock{mutex_};
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (auto & thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+size_t TexturePipeline::decode(const std::span<const unsigned char> encoded)
+{
+	const size_t handle = textures_.size();
+	textures_.emplace_back();
+	{
+		const std::lock_guard lock{mutex_};
+		jobs_.push_back({handle, {encoded.begin(), encoded.end()}});
+		inFlight_++;
+	}
+	wake_.notify_one();
+
+	// Workers start with the first image, a pipeline that never decodes costs no threads.
+	if (threads_.empty())
+	{
+		for (size_t i = 0; i < threadCount_; i++)
+		{
+			threads_.emplace_back(&TexturePipeline::work, this);
+		}
+	}
+	return handle;
+}
+
+size_t TexturePipeline::upload()
+{
+	const ProfileZone zone("texture.upload");
+	std::vector<MipChain> finished;
+	{
+		const std::lock_guard lock{mutex_};
+		finished.swap(finished_);
+	}
+
+	for (const auto & chain : finished)
+	{
+		if (chain.levelOffsets.empty())
+		{
+			std::cerr << "Failed to decode texture " << chain.handle << std::endl;
+			continue;
+		}
+
+		auto texture = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2D);
+		texture->setSize(static_cast<int>(chain.width), static_cast<int>(chain.height));
+		texture->setFormat(QOpenGLTexture::RGBA8_UNorm);
+		texture->setMipLevels(static_cast<int>(chain.levelOffsets.size()));
+		texture->allocateStorage();
+		texture->setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
+		texture->setWrapMode(QOpenGLTexture::Repeat);
+		for (size_t level = 0; level < chain.levelOffsets.size(); level++)
+		{
+			texture->setData(static_cast<int>(level), QOpenGLTexture::RGBA, QOpenGLTexture::UInt8,
+							 chain.pixels.data() + chain.levelOffsets[level]);
+		}
+		textures_[chain.handle] = std::move(texture);
+	}
+	return finished.size();
+}
+
+void TexturePipeline::finish()
+{
+	{
+		std::unique_lock lock{mutex_};
+		done_.wait(lock, [this] { return inFlight_ == 0; });
+	}
+	upload();
+}
+
+void TexturePipeline::release()
+{
+	textures_.clear();
+}
+
+void TexturePipeline::setOnReady(std::function<void()> onReady)
+{
+	onReady_ = std::move(onReady);
+}
+
+QOpenGLTexture * TexturePipeline::texture(const size_t handle) const
+{
+	return textures_[handle].get();
+}
+
+bool TexturePipeline::pending() const
+{
+	const std::lock_guard lock{mutex_};
+	return inFlight_ != 0 || !finished_.empty();
+}
+
+void TexturePipeline::work()
+{
+	Profiler::setThreadName("texture decoder");
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock lock{mutex_};
+			wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+			if (stop_)
+			{
+				return;
+			}
+			job = std::move(jobs_.front());
+			jobs_.pop_front();
+		}
+
+		MipChain chain = build(job);
+		{
+			const std::lock_guard lock{mutex_};
+			finished_.push_back(std::move(chain));
+			inFlight_--;
+		}
+		done_.notify_all();
+		if (onReady_)
+		{
+			onReady_();
+		}
+	}
+}
+
+auto TexturePipeline::build(const Job & job) -> MipChain
+{
+	const ProfileZone zone("texture.decode");
+	MipChain chain;
+	chain.handle = job.handle;
+
+	int width = 0, height = 0, components = 0;
+	unsigned char * const decoded = stbi_load_from_memory(job.encoded.data(), static_cast<int>(job.encoded.size()),
+														  &width, &height, &components, static_cast<int>(CHANNELS));
+	if (decoded == nullptr)
+	{
+		return chain;
+	}
+	chain.width = static_cast<size_t>(width);
+	chain.height = static_cast<size_t>(height);
+
+	// The whole chain is at most 4/3 of the base level.
+	size_t total = 0;
+	const size_t levels = levelCount(chain.width, chain.height);
+	for (size_t level = 0; level < levels; level++)
+	{
+		chain.levelOffsets.push_back(total);
+		total += levelSize(chain.width, level) * levelSize(chain.height, level) * CHANNELS;
+	}
+	chain.pixels.resize(total);
+	std::copy(decoded, decoded + chain.width * chain.height * CHANNELS, chain.pixels.begin());
+	stbi_image_free(decoded);
+
+	for (size_t level = 1; level < levels; level++)
+	{
+		downsample(chain.pixels.data() + chain.levelOffsets[level - 1], levelSize(chain.width, level - 1),
+				   levelSize(chain.height, level - 1), chain.pixels.data() + chain.levelOffsets[level]);
+	}
+	return chain;
+}
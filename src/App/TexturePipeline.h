@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QOpenGLTexture>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+// Decodes PNG/JPEG images and builds their mip chains on worker threads.
+// Finished chains are uploaded on the GL thread, so loading never waits on image decoding.
+class TexturePipeline
+{
+public:
+	// 0 threads: one per hardware thread, minus the GL thread.
+	explicit TexturePipeline(size_t threadCount = 0);
+	~TexturePipeline();
+
+	TexturePipeline(const TexturePipeline &) = delete;
+	TexturePipeline & operator=(const TexturePipeline &) = delete;
+
+	// Queues a copy of the encoded bytes and returns the texture's handle.
+	size_t decode(std::span<const unsigned char> encoded);
+	// Uploads every chain finished so far. Call on the GL thread, returns how many textures became ready.
+	size_t upload();
+	// Blocks until everything queued is decoded, then uploads it.
+	void finish();
+	// Destroys the textures, needs the GL context.
+	void release();
+	// Called on a worker whenever a chain is ready for upload(). Set before the first decode().
+	void setOnReady(std::function<void()> onReady);
+
+	// Null until uploaded, or if the image could not be decoded.
+	[[nodiscard]] QOpenGLTexture * texture(size_t handle) const;
+	// Whether anything is still being decoded or waits for upload().
+	[[nodiscard]] bool pending() const;
+
+private:
+	struct Job
+	{
+		size_t handle = 0;
+		std::vector<unsigned char> encoded;
+	};
+
+	// RGBA8 levels, finest first, packed one after another.
+	struct MipChain
+	{
+		size_t handle = 0;
+		size_t width = 0;
+		size_t height = 0;
+		std::vector<unsigned char> pixels;
+		std::vector<size_t> levelOffsets;// empty: decoding failed
+	};
+
+	void work();
+	static MipChain build(const Job & job);
+
+	size_t threadCount_ = 0;
+	std::vector<std::thread> threads_;
+	std::function<void()> onReady_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::deque<Job> jobs_;
+	std::vector<MipChain> finished_;
+	size_t inFlight_ = 0;// queued or being decoded, not yet finished
+	bool stop_ = false;
+
+	std::vector<std::unique_ptr<QOpenGLTexture>> textures_;// indexed by handle
+};
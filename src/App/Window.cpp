@@ -11,21 +11,29 @@
 #include <QSlider>
 #include <QVBoxLayout>
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 
+#include "AssetLoader.h"
 #include "Duck.h"
 #include "Morth.h"
+#include "Profiler.h"
 
 #include <tinygltf/tiny_gltf.h>
 
 Window::Window() noexcept
 {
-	const auto formatFPS = [](const auto value) {
-		return QString("FPS: %1").arg(QString::number(value));
+	const auto formatFPS = [](const auto value, const FrameSummary & frames, const FrameSummary & gpuFrames) {
+		const auto ms = [](const float value) {
+			return QString::number(value, 'f', 1);
+		};
+		return QString("FPS: %1  CPU ms p50 %2  p95 %3  p99 %4  max %5  hitches %6\nGPU ms p50 %7  p95 %8  max %9")
+			.arg(QString::number(value), ms(frames.p50), ms(frames.p95), ms(frames.p99), ms(frames.max),
+				 QString::number(frames.hitches), ms(gpuFrames.p50), ms(gpuFrames.p95), ms(gpuFrames.max));
 	};
 
-	auto fps = new QLabel(formatFPS(0), this);
+	auto fps = new QLabel(formatFPS(0, {}, {}), this);
 	fps->setStyleSheet("QLabel { color : white; }");
 
 	auto spotLayout = new QHBoxLayout();
@@ -35,7 +43,7 @@ Window::Window() noexcept
 	spotEnableCheck->setChecked(true);
 	connect(spotEnableCheck, &QCheckBox::toggled, [this](bool checked) {
 		enableSpotLight_ = checked;
-		update();
+		requestFrame();
 	});
 
 	auto spotLatLabel = new QLabel("Latitude:", this);
@@ -47,7 +55,7 @@ Window::Window() noexcept
 	spotLatSlider->setFixedWidth(100);
 	connect(spotLatSlider, &QSlider::valueChanged, [this](int value) {
 		spotLightLatitude_ = value / 100.0f;
-		update();
+		requestFrame();
 	});
 
 	auto spotLonLabel = new QLabel("Longitude:", this);
@@ -59,7 +67,7 @@ Window::Window() noexcept
 	spotLonSlider->setFixedWidth(100);
 	connect(spotLonSlider, &QSlider::valueChanged, [this](int value) {
 		spotLightLongitude_ = value / 100.0f;
-		update();
+		requestFrame();
 	});
 
 	spotLayout->addWidget(spotEnableCheck);
@@ -76,7 +84,7 @@ Window::Window() noexcept
 	pointEnableCheck->setChecked(true);
 	connect(pointEnableCheck, &QCheckBox::toggled, [this](bool checked) {
 		enableDotLight_ = checked;
-		update();
+		requestFrame();
 	});
 
 	auto pointAngleLabel = new QLabel("Fov angle:", this);
@@ -88,7 +96,7 @@ Window::Window() noexcept
 	pointAngleSlider->setFixedWidth(100);
 	connect(pointAngleSlider, &QSlider::valueChanged, [this](int value) {
 		dotLightAngle_ = value / 100.0f;
-		update();
+		requestFrame();
 	});
 
 	auto pointHeightLabel = new QLabel("Height:", this);
@@ -100,7 +108,7 @@ Window::Window() noexcept
 	pointHeightSlider->setFixedWidth(100);
 	connect(pointHeightSlider, &QSlider::valueChanged, [this](int value) {
 		dotLightHeight_ = value;
-		update();
+		requestFrame();
 	});
 
 	pointLayout->addWidget(pointEnableCheck);
@@ -110,6 +118,19 @@ Window::Window() noexcept
 	pointLayout->addWidget(pointHeightSlider);
 	pointLayout->addStretch();
 
+	auto animationLayout = new QHBoxLayout();
+
+	auto animateCheck = new QCheckBox("Animate", this);
+	animateCheck->setStyleSheet("QCheckBox { color: white; min-width: 120px; }");
+	animateCheck->setChecked(animated_);
+	connect(animateCheck, &QCheckBox::toggled, [this](bool checked) {
+		animated_ = checked;
+		requestFrame();
+	});
+
+	animationLayout->addWidget(animateCheck);
+	animationLayout->addStretch();
+
 	auto morthingLayout = new QHBoxLayout();
 
 	auto morthingManual = new QCheckBox("Manual lerp", this);
@@ -117,7 +138,7 @@ Window::Window() noexcept
 	morthingManual->setChecked(false);
 	connect(morthingManual, &QCheckBox::toggled, [this](bool checked) {
 		enableManual_ = checked;
-		update();
+		requestFrame();
 	});
 
 	auto morthingModeLabel = new QLabel("Cube color:", this);
@@ -129,7 +150,7 @@ Window::Window() noexcept
 	morthingMode->setFixedWidth(100);
 	connect(morthingMode, &QSlider::valueChanged, [this](int value) {
 		mode_ = value;
-		update();
+		requestFrame();
 	});
 
 	auto morthingLerpK = new QLabel("Lerp coef:", this);
@@ -141,7 +162,7 @@ Window::Window() noexcept
 	morthingInterpolation->setFixedWidth(100);
 	connect(morthingInterpolation, &QSlider::valueChanged, [this](int value) {
 		interpolation_ = value / 1000.0;
-		update();
+		requestFrame();
 	});
 
 	morthingLayout->addWidget(morthingManual);
@@ -156,6 +177,7 @@ Window::Window() noexcept
 	layout->addLayout(spotLayout);
 	layout->addLayout(pointLayout);
 	layout->addLayout(morthingLayout);
+	layout->addLayout(animationLayout);
 
 	setLayout(layout);
 
@@ -176,9 +198,14 @@ Window::Window() noexcept
 	timerMove_.start();
 
 	connect(this, &Window::updateUI, [=] {
-		fps->setText(formatFPS(ui_.fps));
+		fps->setText(formatFPS(ui_.fps, ui_.frames, ui_.gpuFrames));
 	});
 
+	AssetLoaderSettings assetSettings;
+	assetSettings.requestPump = [this] {
+		requestFrame();
+	};
+	assets_ = std::make_unique<AssetLoader>(assetSettings);
 	duck_ = std::make_unique<Duck>();
 	morth_ = std::make_unique<Morth>();
 }
@@ -188,15 +215,19 @@ Window::~Window()
 	{
 		// Free resources with context bounded.
 		const auto guard = bindContext();
+		// Unfinished loads write into the entities, drop them first.
+		assets_->stop();
 		duck_->release();
 		morth_->release();
+		gpuProfiler_.destroy();
 	}
 }
 
 void Window::onInit()
 {
-	duck_->init(this);
+	duck_->init(this, *assets_);
 	morth_->init(this);
+	gpuProfiler_.create();
 
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
@@ -208,17 +239,31 @@ void Window::onInit()
 
 void Window::onRender()
 {
-	// update position:
-	float dt = timerMove_.restart() / 1000.0f;
+	scheduler_.beginFrame();
+
+	// update position, a frame after idling moves as far as one right after another:
+	const float dt = std::min(timerMove_.restart() / 1000.0f, MAX_FRAME_STEP);
 	static constexpr float speed = 10.0f;
 
 	userPos_ += QVector3D(userDir_.x(), 0, userDir_.z()).normalized() * dt * speed * moveForward_;
 	userPos_ += QVector3D(userRight_.x(), 0, userRight_.z()).normalized() * dt * speed * moveRight_;
 
 	const auto guard = captureMetrics();
+	const ProfileZone zone("frame");
+	gpuProfiler_.beginFrame();
+
+	// Continue streaming assets in, within the loader's per frame budget
+	{
+		const auto scope = gpuProfiler_.scope("assets");
+		const ProfileZone assetsZone("assets.pump");
+		assets_->pump();
+	}
 
 	// Clear buffers
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	{
+		const auto scope = gpuProfiler_.scope("clear");
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
 
 	// Calculate MVP matrix
 	view_.setToIdentity();
@@ -226,15 +271,26 @@ void Window::onRender()
 	const auto vp = projection_ * view_;
 
 	// render all entities:
-	duck_->render(this, vp);
-	morth_->render(this, vp);
+	{
+		const auto scope = gpuProfiler_.scope("duck");
+		duck_->render(this, vp);
+	}
+	{
+		const auto scope = gpuProfiler_.scope("morth");
+		morth_->render(this, vp, viewport_);
+	}
 
+	gpuProfiler_.endFrame();
 	++frameCount_;
 
-	// Request redraw if animated
+	// Animations and held movement keys keep drawing, anything else waits for the next request
 	if (animated_)
 	{
-		update();
+		animationTime_ += dt;
+	}
+	if (animated_ || moveForward_ != 0.0f || moveRight_ != 0.0f)
+	{
+		requestFrame();
 	}
 }
 
@@ -242,6 +298,7 @@ void Window::onResize(const size_t width, const size_t height)
 {
 	// Configure viewport
 	glViewport(0, 0, static_cast<GLint>(width), static_cast<GLint>(height));
+	viewport_ = QSize(static_cast<int>(width), static_cast<int>(height));
 
 	// Configure matrix
 	const auto aspect = static_cast<float>(width) / static_cast<float>(height);
@@ -249,6 +306,36 @@ void Window::onResize(const size_t width, const size_t height)
 	projection_.perspective(fov_, aspect, zNear_, zFar_);
 }
 
+bool Window::loading() const
+{
+	return assets_->pending() || duck_->loading();
+}
+
+void Window::requestFrame()
+{
+	scheduler_.requestFrame();
+}
+
+float Window::animationTime() const
+{
+	return animationTime_;
+}
+
+bool Window::saveFrameStats(const QString & path) const
+{
+	FrameStats::Series series{{"cpu", &frameStats_}};
+	for (const auto & [name, stats] : gpuProfiler_.stats())
+	{
+		series.emplace_back(QString::fromStdString("gpu." + name), &stats);
+	}
+	return FrameStats::save(path, series);
+}
+
+const GpuProfiler & Window::gpuProfiler() const
+{
+	return gpuProfiler_;
+}
+
 Window::PerfomanceMetricsGuard::PerfomanceMetricsGuard(std::function<void()> callback)
 	: callback_{std::move(callback)}
 {
@@ -264,12 +351,18 @@ Window::PerfomanceMetricsGuard::~PerfomanceMetricsGuard()
 
 auto Window::captureMetrics() -> PerfomanceMetricsGuard
 {
+	timerFrame_.start();
 	return PerfomanceMetricsGuard{
 		[&] {
+			frameStats_.record(static_cast<float>(timerFrame_.nsecsElapsed()) / 1.0e6f);
 			if (timer_.elapsed() >= 1000)
 			{
 				const auto elapsedSeconds = static_cast<float>(timer_.restart()) / 1000.0f;
 				ui_.fps = static_cast<size_t>(std::round(frameCount_ / elapsedSeconds));
+				ui_.frames = frameStats_.summary(frameCount_);
+				const auto & gpuStats = gpuProfiler_.stats();
+				const auto gpuFrame = gpuStats.find(GpuProfiler::FRAME);
+				ui_.gpuFrames = gpuFrame != gpuStats.end() ? gpuFrame->second.summary(frameCount_) : FrameSummary{};
 				frameCount_ = 0;
 				emit updateUI();
 			}
@@ -305,6 +398,7 @@ void Window::mouseMoveEvent(QMouseEvent * event)
 		userDir_.normalize();
 		userRight_ = QVector3D::crossProduct(userDir_, userUp_);
 		userRight_.normalize();
+		requestFrame();
 	}
 }
 
@@ -317,6 +411,7 @@ void Window::wheelEvent(QWheelEvent * event)
 {
 	float delta = event->angleDelta().y() / 500.0f;
 	userPos_ += userUp_ * delta;
+	requestFrame();
 }
 
 void Window::keyPressEvent(QKeyEvent * event)
@@ -338,6 +433,7 @@ void Window::keyPressEvent(QKeyEvent * event)
 			moveRight_ = -1.0f;
 			break;
 	}
+	requestFrame();
 }
 
 void Window::keyReleaseEvent(QKeyEvent * event)
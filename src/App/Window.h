@@ -2,6 +2,10 @@
 
 #include <Base/GLWidget.hpp>
 
+#include "FrameScheduler.h"
+#include "FrameStats.h"
+#include "GpuProfiler.h"
+
 #include <QDir>
 #include <QElapsedTimer>
 #include <QLabel>
@@ -13,11 +17,13 @@
 #include <QOpenGLTexture>
 #include <QOpenGLVertexArrayObject>
 #include <QScreen>
+#include <QSize>
 #include <QVBoxLayout>
 
 #include <functional>
 #include <memory>
 
+class AssetLoader;
 class Duck;
 class Morth;
 
@@ -33,6 +39,16 @@ public:// fgl::GLWidget
 	void onRender() override;
 	void onResize(size_t width, size_t height) override;
 
+	// Whether assets are still streaming in.
+	[[nodiscard]] bool loading() const;
+	// Draws a frame soon, call after changing anything visible. Any thread.
+	void requestFrame();
+	// Seconds of animation, which only advances while animations run.
+	[[nodiscard]] float animationTime() const;
+	// Writes the CPU and GPU times of the recent frames, as CSV for a .csv path and JSON otherwise.
+	[[nodiscard]] bool saveFrameStats(const QString & path) const;
+	[[nodiscard]] const GpuProfiler & gpuProfiler() const;
+
 private:
 	class PerfomanceMetricsGuard final
 	{
@@ -59,16 +75,25 @@ signals:
 private:
 	QMatrix4x4 view_;
 	QMatrix4x4 projection_;
+	QSize viewport_;
 
 	QElapsedTimer timer_;
 	QElapsedTimer timerMove_;
+	QElapsedTimer timerFrame_;
 	size_t frameCount_ = 0;
+	FrameStats frameStats_;
+	FrameScheduler scheduler_{[this] { update(); }};
+	GpuProfiler gpuProfiler_;
 
 	struct {
 		size_t fps = 0;
+		FrameSummary frames;// of the last second
+		FrameSummary gpuFrames;
 	} ui_;
 
+	// Time-driven animations: the duck's pulse and the morph unless lerped manually.
 	bool animated_ = true;
+	float animationTime_ = 0.0f;
 
 	bool isPressed_ = false;
 	QPoint lastMousePos_;
@@ -88,6 +113,8 @@ private:
 private:
 	static constexpr float EPSILON = 1.0e-4f;
 	static constexpr float EPSILON_SQUARED = EPSILON * EPSILON;
+	// Longest time step of one frame, in seconds.
+	static constexpr float MAX_FRAME_STEP = 0.1f;
 
 	// user
 	float zNear_ = 0.1f;
@@ -113,6 +140,7 @@ public:
 	float interpolation_;
 
 private:
+	std::unique_ptr<AssetLoader> assets_;
 	std::unique_ptr<Duck> duck_;
 	std::unique_ptr<Morth> morth_;
 };
@@ -1,6 +1,13 @@
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QSurfaceFormat>
 
+#include <iostream>
+
+#include "Benchmark.h"
+#include "CookedScene.h"
+#include "Profiler.h"
+
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -20,11 +27,75 @@ int main(int argc, char ** argv)
 	QApplication::setAttribute(Qt::AA_UseDesktopOpenGL);
 	QApplication app(argc, argv);
 
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	const QCommandLineOption cookOption("cook", "Cook <scene.glb> into the file given as argument and exit.", "scene.glb");
+	const QCommandLineOption benchmarkOption("benchmark", "Render offscreen, print frame times as JSON and exit.");
+	const QCommandLineOption framesOption("frames", "Benchmark frames to time.", "count", "500");
+	const QCommandLineOption sizeOption("size", "Benchmark resolution.", "WxH", "1280x720");
+	const QCommandLineOption samplesOption("samples", "Benchmark MSAA samples.", "count", "4");
+	const QCommandLineOption frameStatsOption("frame-stats", "Write frame times on exit, CSV for a .csv path, JSON otherwise.", "path");
+	const QCommandLineOption traceOption("trace", "Record CPU zones and write them on exit as a Chrome trace (ui.perfetto.dev).", "path");
+	parser.addOption(cookOption);
+	parser.addOption(benchmarkOption);
+	parser.addOption(framesOption);
+	parser.addOption(sizeOption);
+	parser.addOption(samplesOption);
+	parser.addOption(frameStatsOption);
+	parser.addOption(traceOption);
+	parser.addPositionalArgument("scene.cooked", "Output of --cook.");
+	parser.process(app);
+
+	// Offline cooking, no window: demo-app --cook <scene.glb> <scene.cooked>
+	if (parser.isSet(cookOption))
+	{
+		const auto positional = parser.positionalArguments();
+		if (positional.size() != 1)
+		{
+			std::cerr << "--cook needs the output path" << std::endl;
+			return 1;
+		}
+		return CookedScene::cook(parser.value(cookOption), positional[0]) ? 0 : 1;
+	}
+
+	// Zones are recorded only when tracing, saving the trace is the last thing either mode does.
+	const bool trace = parser.isSet(traceOption);
+	Profiler::setEnabled(trace);
+	Profiler::setThreadName("render");
+	const auto saveTrace = [&](const int result) {
+		return trace && !Profiler::save(parser.value(traceOption)) ? 1 : result;
+	};
+
 	// Set default surface format.
 	QSurfaceFormat format;
 	format.setSamples(g_sampels);
 	format.setVersion(g_gl_major_version, g_gl_minor_version);
 	format.setProfile(QSurfaceFormat::CoreProfile);
+
+	// Headless benchmark, e.g. QT_QPA_PLATFORM=offscreen demo-app --benchmark --size 1920x1080 --samples 4
+	if (parser.isSet(benchmarkOption))
+	{
+		BenchmarkSettings settings;
+		bool framesOk = false, widthOk = false, heightOk = false, samplesOk = false;
+		const auto size = parser.value(sizeOption).split("x");
+		settings.frames = parser.value(framesOption).toUInt(&framesOk);
+		settings.width = size.size() == 2 ? size[0].toInt(&widthOk) : 0;
+		settings.height = size.size() == 2 ? size[1].toInt(&heightOk) : 0;
+		settings.samples = parser.value(samplesOption).toInt(&samplesOk);
+		settings.frameStatsPath = parser.value(frameStatsOption);
+		if (!framesOk || !widthOk || !heightOk || !samplesOk || settings.width <= 0 || settings.height <= 0)
+		{
+			std::cerr << "Invalid benchmark options" << std::endl;
+			return 1;
+		}
+
+		// The benchmark's framebuffer is multisampled, the surface needs no samples.
+		format.setSamples(0);
+		QSurfaceFormat::setDefaultFormat(format);
+		Benchmark benchmark(settings);
+		return saveTrace(benchmark.run() ? 0 : 1);
+	}
+
 	QSurfaceFormat::setDefaultFormat(format);
 
 	// Now create window.
@@ -32,5 +103,10 @@ int main(int argc, char ** argv)
 	window.resize(640, 480);
 	window.show();
 
-	return app.exec();
+	const int result = app.exec();
+	if (parser.isSet(frameStatsOption) && !window.saveFrameStats(parser.value(frameStatsOption)))
+	{
+		return 1;
+	}
+	return saveTrace(result);
 }
\ No newline at end of file